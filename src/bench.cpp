@@ -0,0 +1,535 @@
+/*
+ * Microbenchmarks of the evaluator and the genetic operators (make bench).
+ *
+ * usage: bench [-r repetitions] [-t seconds] [-o file.json] [-q]
+ *        bench -e [-r repetitions] [-p popsizes] [-n cases] [-T threads] [-g generations] [-G gpsr] [-o file.csv]
+ *
+ * Each benchmark is run -r times (default 7), each repetition doing as many
+ * operations as take about -t seconds (default 0.05), and is reported as
+ * the mean and standard deviation over the repetitions of the time per
+ * operation, and of the nodes evaluated (or handled) per second. The
+ * evaluator is measured over a sweep of genome sizes (gpsr -s) and dataset
+ * sizes, the operators over the genome sizes, loadFiles over the dataset
+ * sizes (text and binary). -q runs a smaller sweep. The random number
+ * generator is seeded the same way before each benchmark, so every run does
+ * the same work.
+ *
+ * A table goes to standard error as the benchmarks run; the results are
+ * written as JSON to the -o file (or standard output).
+ *
+ * With -e, bench runs end-to-end scaling benchmarks instead: whole gpsr
+ * runs on synthetic data, across population sizes, dataset sizes and
+ * numbers of threads, written as CSV (see benchScaling()).
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "global.h"
+#include "gppopulation.h"
+#include "gpoperators.h"
+#include "dataio.h"
+#include "usefulfunctions.h"
+#include "synthetic.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+#define BENCH_SEED 42
+#define BENCH_VARIABLES 5
+#define BENCH_SAMPLE 64		// individuals the operators are applied to in turn
+
+static volatile double sink;
+
+struct BenchResult {
+	string name;
+	int genomeSize;		// -s (0 if it doesn't apply)
+	long cases;		// fitness cases (0 if they don't apply)
+	double nodesPerOp;	// nodes handled by each operation (0 if it doesn't apply)
+	long opsPerRep;
+	vector<double> nsPerOp;	// one per repetition
+};
+
+static int repetitions = 0;	// (-r; 7, or 1 with -e)
+static double repSeconds = 0.05;
+static vector<BenchResult> results;
+
+static double mean(const vector<double> &v) {
+	double sum = 0.0;
+	for (unsigned i = 0; i < v.size(); i++) {
+		sum += v[i];
+	}
+	return sum / v.size();
+}
+
+static double stddev(const vector<double> &v) {
+	double m = mean(v);
+	double sum = 0.0;
+	for (unsigned i = 0; i < v.size(); i++) {
+		sum += (v[i] - m) * (v[i] - m);
+	}
+	return (v.size() > 1) ? sqrt(sum / (v.size() - 1)) : 0.0;
+}
+
+/*
+ * Time an operation (op(i) for i = 0, 1, ...): find how many make up a
+ * repetition, then time the repetitions. The time of work each operation
+ * has to do first but isn't part of what is measured (baselineNs, measured
+ * on its own) is taken off.
+ */
+template <class Op>
+static void measure(const string &name, int genomeSize, long cases, double nodesPerOp, Op op, double baselineNs = 0.0) {
+
+	BenchResult r;
+	r.name = name;
+	r.genomeSize = genomeSize;
+	r.cases = cases;
+	r.nodesPerOp = nodesPerOp;
+
+	long n = 1;
+	long done = 0;
+	while (true) {
+		Clock::time_point start = Clock::now();
+		for (long i = 0; i < n; i++) {
+			op(done++);
+		}
+		double secs = chrono::duration<double>(Clock::now() - start).count();
+		if (secs >= repSeconds / 4 || n >= (1L << 30)) {
+			n = max(1L, (long) (n * repSeconds / max(secs, 1e-9)));
+			break;
+		}
+		n *= 2;
+	}
+	r.opsPerRep = n;
+
+	for (int rep = 0; rep < repetitions; rep++) {
+		Clock::time_point start = Clock::now();
+		for (long i = 0; i < n; i++) {
+			op(done++);
+		}
+		double secs = chrono::duration<double>(Clock::now() - start).count();
+		r.nsPerOp.push_back(max(0.0, secs * 1e9 / n - baselineNs));
+	}
+
+	double ns = mean(r.nsPerOp);
+	cerr << left << setw(28) << name << right << setw(8) << genomeSize << setw(10) << cases
+		<< setw(14) << fixed << setprecision(1) << ns << " ns/op";
+	// (an op no slower than the harness measures as 0, which has no rate)
+	if (ns > 0) {
+		cerr << " +- " << setw(5) << setprecision(1) << 100.0 * stddev(r.nsPerOp) / ns << "%";
+	}
+	if (nodesPerOp > 0 && ns > 0) {
+		cerr << setw(12) << setprecision(1) << nodesPerOp * 1e3 / ns << " Mnodes/s";
+	}
+	cerr << endl;
+	cerr.unsetf(ios::floatfield);
+	results.push_back(r);
+}
+
+static void writeJson(std::ostream &os) {
+
+	os << "{\n  \"seed\": " << BENCH_SEED << ",\n  \"seconds_per_repetition\": " << repSeconds << ",\n  \"benchmarks\": [\n";
+	for (unsigned i = 0; i < results.size(); i++) {
+		const BenchResult &r = results[i];
+		double ns = mean(r.nsPerOp);
+		os << "    {\"name\": \"" << r.name << "\", \"genome_size\": " << r.genomeSize << ", \"cases\": " << r.cases
+			<< ", \"repetitions\": " << r.nsPerOp.size() << ", \"ops_per_repetition\": " << r.opsPerRep
+			<< ", \"ns_per_op\": " << ns << ", \"ns_per_op_stddev\": " << stddev(r.nsPerOp);
+		if (r.nodesPerOp > 0) {
+			// samples measured as 0 ns have no rate (and inf isn't JSON)
+			vector<double> rates;
+			for (unsigned k = 0; k < r.nsPerOp.size(); k++) {
+				if (r.nsPerOp[k] > 0) {
+					rates.push_back(r.nodesPerOp * 1e9 / r.nsPerOp[k]);
+				}
+			}
+			os << ", \"nodes_per_op\": " << r.nodesPerOp;
+			if (rates.empty()) {
+				os << ", \"nodes_per_s\": null, \"nodes_per_s_stddev\": null";
+			}
+			else {
+				os << ", \"nodes_per_s\": " << mean(rates) << ", \"nodes_per_s_stddev\": " << stddev(rates);
+			}
+		}
+		os << ", \"ns_per_op_samples\": [";
+		for (unsigned k = 0; k < r.nsPerOp.size(); k++) {
+			os << (k > 0 ? ", " : "") << r.nsPerOp[k];
+		}
+		os << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	os << "  ]\n}\n";
+}
+
+/*
+ * A synthetic dataset of the given size (friedman1, BENCH_VARIABLES
+ * variables), in the text and binary formats.
+ */
+static bool writeDatasets(long cases, const string &text, const string &binary) {
+
+	SyntheticSpec spec;
+	spec.rows = cases;
+	spec.variables = BENCH_VARIABLES;
+	spec.formula = "friedman1";
+	spec.low = 0.0;
+	spec.high = 1.0;
+	spec.seed = BENCH_SEED;
+	vector<DataColumn> vars;
+	DataColumn trg;
+	string error;
+	if (!generateDataset(spec, vars, trg, error)) {
+		cerr << error << endl;
+		return false;
+	}
+	return (text == "" || writeTextDataset(text, vars, trg)) && writeBinaryDataset(binary, vars, trg);
+}
+
+static double meanSize(const GPPopulation &pop) {
+	double nodes = 0.0;
+	for (int i = 0; i < pop.getSize(); i++) {
+		nodes += pop.getIndividual(i)->getSize();
+	}
+	return nodes / pop.getSize();
+}
+
+/*
+ * The evaluator on the dataset loaded, for each genome size.
+ */
+static void benchEvaluation(const vector<int> &genomeSizes) {
+
+	long cases = targets.size();
+	for (unsigned g = 0; g < genomeSizes.size(); g++) {
+		rng.reseed(BENCH_SEED);
+		GPPopulation pop(BENCH_SAMPLE, genomeSizes[g]);
+		double nodes = meanSize(pop);
+
+		measure("evaluate", genomeSizes[g], cases, nodes * cases, [&](long i) {
+			ResultType guesses = pop.getIndividual(i % BENCH_SAMPLE)->evaluate(true);
+			sink = guesses[0];
+		});
+		baseConfig.linear_scaling = false;
+		measure("calcFitness", genomeSizes[g], cases, nodes * cases, [&](long i) {
+			sink = pop.getIndividual(i % BENCH_SAMPLE)->calcFitness(true, false);
+		});
+		baseConfig.linear_scaling = true;
+		measure("calcFitness_ls", genomeSizes[g], cases, nodes * cases, [&](long i) {
+			sink = pop.getIndividual(i % BENCH_SAMPLE)->calcFitness(true, true);
+		});
+		baseConfig.linear_scaling = false;
+	}
+}
+
+/*
+ * The operators, for each genome size (they don't touch the data).
+ */
+static void benchOperators(const vector<int> &genomeSizes) {
+
+	for (unsigned g = 0; g < genomeSizes.size(); g++) {
+		int size = genomeSizes[g];
+		baseConfig.genomeSize = size;
+		rng.reseed(BENCH_SEED);
+		GPPopulation pop(BENCH_SAMPLE, size);
+		for (int i = 0; i < pop.getSize(); i++) {
+			pop.getIndividual(i)->setFitness(i);
+		}
+		double nodes = meanSize(pop);
+
+		// the mutations work on copies, so that is timed on its own too
+		rng.reseed(BENCH_SEED);
+		measure("copy", size, 0, nodes, [&](long i) {
+			GPProgram copy(*(pop.getIndividual(i % BENCH_SAMPLE)));
+			sink = copy.getSize();
+		});
+		rng.reseed(BENCH_SEED);
+		measure("xover", size, 0, 2 * nodes, [&](long i) {
+			GPProgram *child = xover(*(pop.getIndividual(i % BENCH_SAMPLE)), *(pop.getIndividual((i + 1) % BENCH_SAMPLE)));
+			sink = child->getSize();
+			delete child;
+		});
+		rng.reseed(BENCH_SEED);
+		measure("branchMutate", size, 0, nodes, [&](long i) {
+			GPProgram copy(*(pop.getIndividual(i % BENCH_SAMPLE)));
+			branchMutate(copy);
+			sink = copy.getSize();
+		});
+		rng.reseed(BENCH_SEED);
+		measure("nodeMutate", size, 0, nodes, [&](long i) {
+			GPProgram copy(*(pop.getIndividual(i % BENCH_SAMPLE)));
+			nodeMutate(copy);
+			sink = copy.getSize();
+		});
+
+		baseConfig.popsize = 500;
+		rng.reseed(BENCH_SEED);
+		GPPopulation big(baseConfig.popsize, size);
+		for (int i = 0; i < big.getSize(); i++) {
+			big.getIndividual(i)->setFitness(i);
+		}
+		// selection works on a copy of the population each time, which
+		// would otherwise be most of the time measured
+		rng.reseed(BENCH_SEED);
+		measure("GPPopulation_copy_500", size, 0, 0, [&](long) {
+			GPPopulation copy(big);
+			sink = copy.getIndividual(0)->getSize();
+		});
+		double copyNs = mean(results.back().nsPerOp);
+		rng.reseed(BENCH_SEED);
+		measure("tournamentSelection_500", size, 0, 0, [&](long) {
+			GPPopulation copy(big);
+			tournamentSelection(copy);
+			sink = copy.getIndividual(0)->getSize();
+		}, copyNs);
+		rng.reseed(BENCH_SEED);
+		measure("GPPopulation_500", size, 0, 0, [&](long) {
+			GPPopulation fresh(baseConfig.popsize, size);
+			sink = fresh.getIndividual(0)->getSize();
+		});
+	}
+}
+
+//
+// end-to-end scaling (-e)
+//
+
+static vector<long> parseList(const char *text) {
+	vector<long> ret;
+	stringstream s(text);
+	string item;
+	while (getline(s, item, ',')) {
+		ret.push_back(atol(item.c_str()));
+	}
+	return ret;
+}
+
+/*
+ * Run gpsr with the given arguments (its output thrown away), and time it.
+ * @return false if it didn't run or failed
+ */
+static bool runGpsr(const string &gpsr, const vector<string> &args, double &seconds, long &peakKB) {
+
+	vector<char*> argv;
+	argv.push_back((char*) gpsr.c_str());
+	for (unsigned i = 0; i < args.size(); i++) {
+		argv.push_back((char*) args[i].c_str());
+	}
+	argv.push_back(0);
+
+	Clock::time_point start = Clock::now();
+	pid_t pid = fork();
+	if (pid < 0) {
+		return false;
+	}
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, 1);
+		dup2(null, 2);
+		execv(gpsr.c_str(), argv.data());
+		_exit(127);
+	}
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) != pid) {
+		return false;
+	}
+	seconds = chrono::duration<double>(Clock::now() - start).count();
+	peakKB = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*
+ * Run fixed evolutions (-g generations, seed 1) for every combination of
+ * population size, training set size and number of threads, each in a
+ * process of its own, and write a CSV line for each: the best wall-clock
+ * time of the repetitions, the fitness cases evaluated per second
+ * (popsize x generations x cases / time), the speedup over the first
+ * number of threads listed, and the peak resident memory of the process.
+ */
+static int benchScaling(const string &gpsr, const vector<long> &popsizes, const vector<long> &datasetSizes,
+	const vector<long> &threads, int generations, std::ostream &os) {
+
+	char dir[] = "/tmp/gpsr-bench-XXXXXX";
+	if (mkdtemp(dir) == 0) {
+		cerr << "Could not make a directory for the datasets" << endl;
+		return EXIT_FAILURE;
+	}
+	string train = string(dir) + "/train.bin";
+	string test = string(dir) + "/test.bin";
+	if (!writeDatasets(1000, "", test)) {
+		cerr << "Could not write the datasets" << endl;
+		return EXIT_FAILURE;
+	}
+
+	int ret = EXIT_SUCCESS;
+	os << "popsize,cases,threads,generations,seconds,cases_per_second,speedup,peak_rss_kb" << endl;
+	for (unsigned d = 0; d < datasetSizes.size() && ret == EXIT_SUCCESS; d++) {
+		if (!writeDatasets(datasetSizes[d], "", train)) {
+			cerr << "Could not write the datasets" << endl;
+			ret = EXIT_FAILURE;
+			break;
+		}
+		for (unsigned p = 0; p < popsizes.size() && ret == EXIT_SUCCESS; p++) {
+			double baseline = 0.0;
+			for (unsigned t = 0; t < threads.size(); t++) {
+				ostringstream pop, gens, nthreads;
+				pop << popsizes[p];
+				gens << generations;
+				nthreads << threads[t];
+				vector<string> args = { "-d", train, "-f", test, "-p", pop.str(), "-g", gens.str(), "-T", nthreads.str(),
+					"-D", "1", "-o", string(dir) + "/best", "-O", string(dir) + "/res" };
+
+				double best = 0.0;
+				long peakKB = 0;
+				for (int rep = 0; rep < repetitions; rep++) {
+					double seconds;
+					long kb;
+					if (!runGpsr(gpsr, args, seconds, kb)) {
+						cerr << "Could not run " << gpsr << endl;
+						ret = EXIT_FAILURE;
+						break;
+					}
+					best = (rep == 0) ? seconds : min(best, seconds);
+					peakKB = max(peakKB, kb);
+				}
+				if (ret != EXIT_SUCCESS) {
+					break;
+				}
+				if (t == 0) {
+					baseline = best;
+				}
+				double rate = (double) popsizes[p] * generations * datasetSizes[d] / best;
+				os << popsizes[p] << "," << datasetSizes[d] << "," << threads[t] << "," << generations << ","
+					<< best << "," << rate << "," << baseline / best << "," << peakKB << endl;
+				cerr << "popsize " << popsizes[p] << ", " << datasetSizes[d] << " cases, " << threads[t] << " threads: "
+					<< best << " s, speedup " << baseline / best << ", " << peakKB / 1024 << " MB" << endl;
+			}
+		}
+	}
+
+	unlink(train.c_str());
+	unlink(test.c_str());
+	unlink((string(dir) + "/best").c_str());
+	unlink((string(dir) + "/best.model").c_str());
+	unlink((string(dir) + "/res").c_str());
+	rmdir(dir);
+	return ret;
+}
+
+static void usage(const char *arg) {
+	cerr << "usage: " << arg << " [-r repetitions] [-t seconds] [-o file.json] [-q]" << endl;
+	cerr << "       " << arg << " -e [-r repetitions] [-p popsizes] [-n cases] [-T threads] [-g generations] [-G gpsr] [-o file.csv]" << endl;
+	cerr << "  -e  end-to-end scaling: time gpsr runs for every combination of the (comma-separated) lists" << endl;
+	cerr << "      -p (default: 200,1000), -n (default: 1000,10000) and -T (default: 1,2,4)," << endl;
+	cerr << "      for -g generations (default: 10), with the gpsr binary -G (default: gpsr next to bench)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+	string jsonFile = "";
+	bool quick = false;
+	bool scaling = false;
+	vector<long> popsizes = { 200, 1000 };
+	vector<long> scalingSizes = { 1000, 10000 };
+	vector<long> threads = { 1, 2, 4 };
+	int generations = 10;
+	string dirName = argv[0];
+	string gpsr = (dirName.rfind('/') == string::npos) ? "gpsr" : dirName.substr(0, dirName.rfind('/') + 1) + "gpsr";
+	int c;
+	while ((c = getopt(argc, argv, "r:t:o:qep:n:T:g:G:")) != -1) {
+		switch (c) {
+			case 'r': repetitions = atoi(optarg); break;
+			case 't': repSeconds = atof(optarg); break;
+			case 'o': jsonFile = optarg; break;
+			case 'q': quick = true; break;
+			case 'e': scaling = true; break;
+			case 'p': popsizes = parseList(optarg); break;
+			case 'n': scalingSizes = parseList(optarg); break;
+			case 'T': threads = parseList(optarg); break;
+			case 'g': generations = atoi(optarg); break;
+			case 'G': gpsr = optarg; break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (repetitions < 1) {
+		repetitions = scaling ? 1 : 7;
+	}
+
+	if (scaling) {
+		if (popsizes.empty() || scalingSizes.empty() || threads.empty()) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (jsonFile != "") {
+			std::ofstream out(jsonFile.c_str());
+			return benchScaling(gpsr, popsizes, scalingSizes, threads, generations, out);
+		}
+		return benchScaling(gpsr, popsizes, scalingSizes, threads, generations, cout);
+	}
+
+	vector<int> genomeSizes;
+	vector<long> datasetSizes;
+	genomeSizes.push_back(32);
+	genomeSizes.push_back(128);
+	datasetSizes.push_back(1000);
+	datasetSizes.push_back(10000);
+	if (!quick) {
+		genomeSizes.push_back(512);
+		datasetSizes.push_back(100000);
+	}
+
+	char dir[] = "/tmp/gpsr-bench-XXXXXX";
+	if (mkdtemp(dir) == 0) {
+		cerr << "Could not make a directory for the datasets" << endl;
+		return EXIT_FAILURE;
+	}
+
+	cerr << left << setw(28) << "benchmark" << right << setw(8) << "genome" << setw(10) << "cases" << setw(14) << "time" << endl;
+	for (unsigned d = 0; d < datasetSizes.size(); d++) {
+		long cases = datasetSizes[d];
+		string text = string(dir) + "/data.dat";
+		string binary = string(dir) + "/data.bin";
+		if (!writeDatasets(cases, text, binary)) {
+			cerr << "Could not write the datasets" << endl;
+			return EXIT_FAILURE;
+		}
+
+		measure("loadFiles_text", 0, cases, 0, [&](long) {
+			loadFiles(text, text);
+		});
+		measure("loadFiles_binary", 0, cases, 0, [&](long) {
+			loadFiles(binary, binary);
+		});
+		if (d == 0) {
+			rng.reseed(1);
+			setupNodeLists();
+			benchOperators(genomeSizes);
+		}
+		benchEvaluation(genomeSizes);
+
+		unlink(text.c_str());
+		unlink(binary.c_str());
+	}
+	rmdir(dir);
+
+	if (jsonFile != "") {
+		std::ofstream out(jsonFile.c_str());
+		writeJson(out);
+	}
+	else {
+		writeJson(cout);
+	}
+	cleanup();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "serialize.h"
+#include "streaming.h"
+#include "global.h"
+#include "trace.h"
+
+using namespace std;
+
+static unsigned long long fnv1a(const char *p, size_t n) {
+	unsigned long long h = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < n; i++) {
+		h ^= (unsigned char) p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static unsigned char settingFlags() {
+	return config->no_same_mates | config->linear_scaling << 1 | config->use_potency << 2 | config->potency_increasing << 3
+		| parallel_breeding << 4;
+}
+
+/*
+ * The settings the rest of the run depends on (besides the data and the
+ * population size).
+ */
+static void encodeSettings(ByteWriter &w) {
+	w.putVarint(config->genomeSize);
+	w.putVarint(config->tournamentSize);
+	w.putDouble(config->crossover_prob);
+	w.putDouble(config->mutation_prob);
+	w.putVarint(config->numgens);
+	w.putU8(settingFlags());
+	w.putDouble(config->hitsCriterion);
+	w.putString(unaries);
+	w.putVarint(shardSize);
+}
+
+/*
+ * Whether the settings read back are those of this run (numgens is set to
+ * the run's -g, which is left to the caller).
+ */
+static bool sameSettings(ByteReader &r, int &numgens) {
+	bool same = (int) r.getVarint() == config->genomeSize;
+	same = (int) r.getVarint() == config->tournamentSize && same;
+	same = r.getDouble() == config->crossover_prob && same;
+	same = r.getDouble() == config->mutation_prob && same;
+	numgens = r.getVarint();
+	same = r.getU8() == settingFlags() && same;
+	same = r.getDouble() == config->hitsCriterion && same;
+	same = r.getString() == unaries && same;
+	same = (int) r.getVarint() == shardSize && same;
+	return r.ok() && same;
+}
+
+/*
+ * The checkpoint of a population: the run it belongs to (so it isn't
+ * resumed with other data or settings), the generation, the seed, the
+ * random number generator, the constants, and the population.
+ */
+static void encodeCheckpoint(ByteWriter &w, const GPPopulation &pop, int generation) {
+
+	w.putBytes(CHECKPOINT_MAGIC, 8);
+	w.putU32(CHECKPOINT_VERSION);
+
+	w.putVarint(numVariables);
+	w.putVarint(numTrainingCases());
+	w.putVarint(pop.getSize());
+	encodeSettings(w);
+
+	w.putVarint(generation);
+	w.putU64(seed);
+	RNG::State state = rng.getState();
+	w.putU8(state.engine);
+	w.putU64(state.seed);
+	for (int i = 0; i < 5; i++) {
+		w.putDouble(state.x[i]);
+	}
+	for (int i = 0; i < 4; i++) {
+		w.putU64(state.s[i]);
+	}
+
+	w.putVarint(constants.size());
+	for (unsigned i = 0; i < constants.size(); i++) {
+		w.putDouble(constants[i]);
+	}
+
+	w.putVarint(pop.getIndexOfBest());
+	for (int i = 0; i < pop.getSize(); i++) {
+		writeProgram(w, *(pop.getIndividual(i)));
+	}
+
+	w.putU64(fnv1a(w.data().data(), w.data().size()));
+}
+
+/*
+ * Write a checkpoint to a temporary file, and put it in place of the last
+ * one once it is safely on disk.
+ */
+static bool writeFile(const string &filename, const string &data) {
+
+	string tmp = filename + ".tmp";
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		return false;
+	}
+	size_t done = 0;
+	while (done < data.size()) {
+		ssize_t k = ::write(fd, data.data() + done, data.size() - done);
+		if (k < 0 && errno == EINTR) {
+			continue;
+		}
+		if (k <= 0) {
+			break;
+		}
+		done += k;
+	}
+	bool ok = done == data.size() && fsync(fd) == 0;
+	ok = (::close(fd) == 0) && ok;
+	if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+//
+// CheckpointWriter
+//
+
+CheckpointWriter::CheckpointWriter(const std::string &filename) {
+	this->filename = filename;
+	havePending = false;
+	stopping = false;
+	writer = thread(&CheckpointWriter::writeCheckpoints, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	close();
+}
+
+void CheckpointWriter::save(const GPPopulation &pop, int generation) {
+
+	ByteWriter w;
+	encodeCheckpoint(w, pop, generation);
+	{
+		lock_guard<mutex> l(lock);
+		pending = w.data();
+		havePending = true;
+	}
+	wake.notify_one();
+}
+
+void CheckpointWriter::close() {
+	{
+		lock_guard<mutex> l(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	if (writer.joinable()) {
+		writer.join();
+	}
+}
+
+void CheckpointWriter::writeCheckpoints() {
+
+	setTraceThreadName("checkpoint writer");
+	unique_lock<mutex> l(lock);
+	while (true) {
+		wake.wait(l, [this] { return havePending || stopping; });
+		if (!havePending) {
+			return;		// stopping, with everything written
+		}
+		string data;
+		data.swap(pending);
+		havePending = false;
+
+		l.unlock();
+		{
+			TRACE_SPAN("checkpoint write");
+			if (!writeFile(filename, data)) {
+				cerr << "Could not write checkpoint " << filename << endl;
+			}
+		}
+		l.lock();
+	}
+}
+
+//
+// resuming
+//
+
+bool readCheckpoint(const std::string &filename, GPPopulation &pop, int &generation) {
+
+	ifstream in(filename.c_str(), ios::binary);
+	stringstream contents;
+	contents << in.rdbuf();
+	string data = contents.str();
+	if (!in || data.size() < 8 + 4 + 8 || memcmp(data.data(), CHECKPOINT_MAGIC, 8) != 0) {
+		cerr << filename << " is not a checkpoint" << endl;
+		return false;
+	}
+	ByteReader check(data.data() + data.size() - 8, 8);
+	if (check.getU64() != fnv1a(data.data(), data.size() - 8)) {
+		cerr << "Checkpoint " << filename << " is corrupt" << endl;
+		return false;
+	}
+
+	ByteReader r(data.data() + 8, data.size() - 8 - 8);
+	if (r.getU32() != CHECKPOINT_VERSION) {
+		cerr << "Checkpoint " << filename << " was written by another version of gpsr" << endl;
+		return false;
+	}
+	long vars = r.getVarint();
+	long cases = r.getVarint();
+	int size = r.getVarint();
+	if (vars != numVariables || cases != numTrainingCases() || size != config->popsize) {
+		cerr << "Checkpoint " << filename << " is of a run with other data or population size" << endl;
+		return false;
+	}
+	// the settings must be the same, but for -g, which may be raised (when
+	// potency, which depends on it, is off)
+	int numgens;
+	if (!sameSettings(r, numgens) || (config->use_potency ? numgens != config->numgens : numgens > config->numgens)) {
+		cerr << "Checkpoint " << filename << " is of a run with other settings" << endl;
+		return false;
+	}
+
+	int gen = r.getVarint();
+	ulong runSeed = r.getU64();
+	RNG::State state;
+	state.engine = (RNG::Engine) r.getU8();
+	state.seed = r.getU64();
+	for (int i = 0; i < 5; i++) {
+		state.x[i] = r.getDouble();
+	}
+	for (int i = 0; i < 4; i++) {
+		state.s[i] = r.getU64();
+	}
+
+	unsigned numConsts = r.getVarint();
+	if (!r.ok() || numConsts != constants.size()) {
+		cerr << "Checkpoint " << filename << " is of a run with another number of constants (-j)" << endl;
+		return false;
+	}
+	// (the constants are those of the run, whatever -r says now)
+	for (unsigned i = 0; i < numConsts; i++) {
+		constants[i] = r.getDouble();
+	}
+
+	int best = r.getVarint();
+	bool ok = r.ok() && best >= 0 && best < size;
+	vector<GPProgram*> programs;
+	for (int i = 0; i < size && ok; i++) {
+		programs.push_back(new GPProgram());
+		ok = readProgram(r, *(programs.back()));
+	}
+	if (!ok || !r.atEnd()) {
+		for (unsigned i = 0; i < programs.size(); i++) {
+			delete programs[i];
+		}
+		cerr << "Checkpoint " << filename << " can't be read" << endl;
+		return false;
+	}
+
+	pop.setPopulation(programs);
+	pop.setIndexOfBest(best);
+	seed = runSeed;
+	rng.setState(state);
+	generation = gen;
+	return true;
+}
@@ -0,0 +1,92 @@
+/** \file checkpoint.h
+ * Checkpoints of a generational run (--checkpoint), and resuming from them
+ * (--resume).
+ *
+ * A checkpoint holds everything the rest of the run depends on: the
+ * generation it was taken after, the run's settings, the seed and the state
+ * of the random number generator, the constants, and the population (each
+ * individual encoded as in serialize.h, with its fitness and LS
+ * coefficients). A run resumed from a checkpoint carries on exactly as the
+ * run that wrote it did, as long as it is given the same data; a checkpoint
+ * is refused if the settings have changed, but for -g, which may be raised
+ * to run on for longer unless potency (-P) is on, since how much LS it
+ * applies depends on how far through the run a generation is.
+ *
+ * The population is encoded by the thread evolving it, which is quick, and
+ * the encoding is written out by a background thread, so the run doesn't
+ * wait for the disk. A checkpoint is written to a temporary file that
+ * then replaces the checkpoint file, so there is always a whole checkpoint
+ * to resume from.
+ *
+ * A checkpoint file is CHECKPOINT_MAGIC, then the fields written by
+ * encodeCheckpoint() (checkpoint.cpp) in the serialize.h encoding, and
+ * finally an FNV-1a checksum of everything before it.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "gppopulation.h"
+
+#define CHECKPOINT_MAGIC "GPSRCKP1"
+#define CHECKPOINT_VERSION 3
+
+class CheckpointWriter {
+
+	public:
+		/**
+		 * Constructor. Starts the thread that writes the checkpoints.
+		 * @param filename the checkpoint file
+		 */
+		explicit CheckpointWriter(const std::string &filename);
+
+		/**
+		 * Destructor. Writes out the last checkpoint taken.
+		 */
+		~CheckpointWriter();
+
+		/**
+		 * Take a checkpoint, to be written in the background. If the
+		 * previous one is still waiting to be written, it is dropped for
+		 * this one.
+		 * @param pop the population
+		 * @param generation the generation just evolved
+		 */
+		void save(const GPPopulation &pop, int generation);
+
+		/**
+		 * Write out the last checkpoint taken and stop the thread.
+		 */
+		void close();
+
+	private:
+		CheckpointWriter(const CheckpointWriter &);	// not copyable
+		void operator=(const CheckpointWriter &);
+
+		void writeCheckpoints();
+
+		std::string filename;
+		std::string pending;	// the checkpoint waiting to be written
+		bool havePending;
+		bool stopping;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::thread writer;
+};
+
+/**
+ * Read a checkpoint back, to resume the run. Sets the seed, the state of
+ * the random number generator and the constants, and fills the population.
+ * @param filename the checkpoint file
+ * @param pop an empty population, set to the checkpointed one
+ * @param generation set to the generation the checkpoint was taken after
+ * @return false (having said why) if the checkpoint can't be used
+ */
+bool readCheckpoint(const std::string &filename, GPPopulation &pop, int &generation);
+
+#endif
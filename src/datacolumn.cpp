@@ -0,0 +1,69 @@
+#include "datacolumn.h"
+
+using namespace std;
+
+DataColumn::DataColumn() {
+	values = 0;
+	n = 0;
+}
+
+DataColumn::DataColumn(const DataColumn &other) {
+	values = 0;
+	n = 0;
+	*this = other;
+}
+
+DataColumn& DataColumn::operator=(const DataColumn &other) {
+	if (this == &other) {
+		return *this;
+	}
+	if (other.owner) {
+		own.resize(0);
+		values = other.values;
+		owner = other.owner;
+	}
+	else {
+		own.resize(other.n);
+		own = other.own;
+		values = (other.n > 0) ? &own[0] : 0;
+		owner.reset();
+	}
+	n = other.n;
+	return *this;
+}
+
+void DataColumn::resize(size_t n) {
+	owner.reset();
+	own.resize(n);
+	own = 0.0;
+	this->values = (n > 0) ? &own[0] : 0;
+	this->n = n;
+}
+
+void DataColumn::view(double *values, size_t n, const std::shared_ptr<void> &owner) {
+	own.resize(0);
+	this->values = values;
+	this->n = n;
+	this->owner = owner;
+}
+
+size_t DataColumn::size() const {
+	return n;
+}
+
+valarray<double> DataColumn::operator[](slice cases) const {
+	return valarray<double>(values + cases.start(), cases.size());
+}
+
+const double* DataColumn::data() const {
+	return values;
+}
+
+valarray<double> operator-(const valarray<double> &a, const DataColumn &b) {
+	valarray<double> ret(a.size());
+	const double *v = b.data();
+	for (size_t i = 0; i < a.size(); i++) {
+		ret[i] = a[i] - v[i];
+	}
+	return ret;
+}
@@ -0,0 +1,77 @@
+/**
+ * DataColumn class.
+ *
+ * One column of a dataset (the values of a variable, or the targets, for
+ * every fitness case). A column either holds its values itself, or is a view
+ * of values that live elsewhere, such as a column of a memory-mapped binary
+ * dataset (see dataio.h), in which case nothing is copied at all. The
+ * evaluation reads columns a slice of fitness cases at a time, as
+ * valarrays.
+ *
+ * Copies of a view are views of the same values; copies of a column that
+ * holds its values get their own.
+ */
+
+#ifndef DATACOLUMN_H
+#define DATACOLUMN_H
+
+#include <valarray>
+#include <memory>
+#include <cstddef>
+
+class DataColumn {
+
+	public:
+		DataColumn();
+		DataColumn(const DataColumn &other);
+		DataColumn& operator=(const DataColumn &other);
+
+		/**
+		 * Hold n values of its own (all 0).
+		 * @param n the number of values
+		 */
+		void resize(size_t n);
+
+		/**
+		 * Become a view of values that live elsewhere.
+		 * @param values the values (writable: a private mapping will do)
+		 * @param n the number of values
+		 * @param owner whatever keeps the values alive (shared by all views)
+		 */
+		void view(double *values, size_t n, const std::shared_ptr<void> &owner);
+
+		/**
+		 * @return the number of values
+		 */
+		size_t size() const;
+
+		double& operator[](size_t i) { return values[i]; }
+		const double& operator[](size_t i) const { return values[i]; }
+
+		/**
+		 * @param cases a slice of fitness cases
+		 * @return a copy of the values of those cases
+		 */
+		std::valarray<double> operator[](std::slice cases) const;
+
+		/**
+		 * @return the values
+		 */
+		const double* data() const;
+
+	private:
+		std::valarray<double> own;		// the values, unless a view
+		double *values;
+		size_t n;
+		std::shared_ptr<void> owner;	// keeps a view's values alive
+};
+
+/**
+ * Element-wise difference of guesses and a column.
+ * @param a the guesses
+ * @param b the column
+ * @return a - b
+ */
+std::valarray<double> operator-(const std::valarray<double> &a, const DataColumn &b);
+
+#endif
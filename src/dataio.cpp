@@ -0,0 +1,641 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dataio.h"
+#include "threadpool.h"
+
+using namespace std;
+
+/* the text is parsed in chunks of about this many bytes */
+#define DATA_CHUNK_BYTES (4 * 1024 * 1024)
+
+/* text is written in blocks of this many cases, formatted by the worker pool */
+#define DATA_WRITE_CASES 16384
+
+//
+// MappedFile
+//
+
+MappedFile::MappedFile() {
+	start = 0;
+	length = 0;
+}
+
+MappedFile::~MappedFile() {
+	if (start != 0) {
+		munmap(start, length);
+	}
+}
+
+bool MappedFile::open(const std::string &filename, bool writable) {
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+	void *p = mmap(0, st.st_size, prot, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	start = (char*) p;
+	length = st.st_size;
+	return true;
+}
+
+const char* MappedFile::data() const {
+	return start;
+}
+
+char* MappedFile::data() {
+	return start;
+}
+
+size_t MappedFile::size() const {
+	return length;
+}
+
+void MappedFile::advise(int advice, size_t offset, size_t bytes) {
+	static const size_t pageSize = sysconf(_SC_PAGESIZE);
+
+	if (offset >= length) {
+		return;
+	}
+	bytes = min(bytes, length - offset);
+	size_t first = offset / pageSize * pageSize;
+	madvise(start + first, bytes + (offset - first), advice);
+}
+
+//
+// numbers
+//
+
+static inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isSpace(char c) {
+	return isBlank(c) || c == '\n' || c == '\v' || c == '\f';
+}
+
+bool parseNumber(const char *&p, const char *end, double &value) {
+
+	// powers of ten that are exact in a double
+	static const double exact[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	while (p < end && isBlank(*p)) {
+		p++;
+	}
+	const char *s = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	// up to 19 significant digits fit in the mantissa
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool truncated = false;
+	bool any = false;
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		any = true;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += (mantissa != 0);
+		}
+		else {
+			exponent++;
+			truncated |= (*p != '0');
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+			any = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += (mantissa != 0);
+				exponent--;
+			}
+			else {
+				truncated |= (*p != '0');
+			}
+		}
+	}
+	if (any && p < end && (*p == 'e' || *p == 'E')) {
+		const char *e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExponent = (*e == '-');
+			e++;
+		}
+		if (e < end && *e >= '0' && *e <= '9') {
+			int x = 0;
+			for (; e < end && *e >= '0' && *e <= '9'; e++) {
+				if (x < 100000) {
+					x = x * 10 + (*e - '0');
+				}
+			}
+			exponent += negativeExponent ? -x : x;
+			p = e;
+		}
+	}
+
+	if (any && (p == end || isSpace(*p))) {
+		// the fast path: mantissa and power of ten are exact, so one
+		// (correctly rounded) multiplication or division gives the answer
+		if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+			double v = (double) mantissa;
+			v = (exponent < 0) ? v / exact[-exponent] : v * exact[exponent];
+			value = negative ? -v : v;
+			return true;
+		}
+	}
+
+	// anything else (very long or very large numbers, inf, nan) goes to
+	// strtod; the program never changes the C locale, so '.' is the point
+	p = s;
+	size_t n = 0;
+	while (p + n < end && !isSpace(p[n])) {
+		n++;
+	}
+	char buf[64];
+	std::string token;
+	const char *t = buf;
+	if (n < sizeof(buf)) {
+		memcpy(buf, p, n);
+		buf[n] = '\0';
+	}
+	else {
+		token.assign(p, n);
+		t = token.c_str();
+	}
+	char *stop;
+	value = strtod(t, &stop);
+	if (n == 0 || (size_t) (stop - t) != n) {
+		return false;
+	}
+	p += n;
+	return true;
+}
+
+//
+// datasets
+//
+
+/*
+ * Skip to the start of the next line.
+ */
+static inline const char* nextLine(const char *p, const char *end) {
+	const char *nl = (const char*) memchr(p, '\n', end - p);
+	return (nl == 0) ? end : nl + 1;
+}
+
+/*
+ * Whether the line starting at p has nothing on it.
+ */
+static inline bool blankLine(const char *p, const char *end) {
+	while (p < end && isBlank(*p)) {
+		p++;
+	}
+	return p == end || *p == '\n';
+}
+
+/*
+ * Whether a mapped file is a binary dataset.
+ */
+static bool isBinary(const MappedFile &file) {
+	return file.size() >= 8 && memcmp(file.data(), BINARY_DATASET_MAGIC, 8) == 0;
+}
+
+/*
+ * Read and check the header of a binary dataset.
+ */
+static bool readBinaryHeader(const MappedFile &file, BinaryDatasetHeader &header) {
+
+	// a big-endian machine would see a dtype it doesn't know
+	if (file.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	return header.version == BINARY_DATASET_VERSION && header.dtype == BINARY_DATASET_FLOAT64
+			&& header.columns >= 1
+			&& header.rows <= header.columnBytes / sizeof(double)
+			&& header.columnBytes % BINARY_DATASET_ALIGN == 0
+			&& header.dataOffset >= sizeof(header) && header.dataOffset % BINARY_DATASET_ALIGN == 0
+			&& header.dataOffset <= file.size()
+			&& header.columns <= (file.size() - header.dataOffset) / max(header.columnBytes, (uint64_t) 1);
+}
+
+/*
+ * Read the header line of a text dataset: # ncases nvars
+ */
+static bool readTextHeader(const MappedFile &file, long &ncases, int &nvars, bool &hasHeader, const char *&body) {
+
+	const char *p = file.data();
+	const char *end = p + file.size();
+	hasHeader = (*p == '#');
+	body = nextLine(p, end);
+	double header[2];
+	p++;
+	if (!parseNumber(p, body, header[0]) || !parseNumber(p, body, header[1]) || header[0] < 0 || header[1] < 1) {
+		return false;
+	}
+	ncases = (long) header[0];
+	nvars = (int) header[1] - 1; // last one is target
+	return true;
+}
+
+/*
+ * Parse a fitness case (a line, without its newline) into element i of the
+ * columns.
+ */
+static bool parseCase(const char *q, const char *lineEnd, std::vector<DataColumn> &vars, DataColumn &targets, long i) {
+
+	bool ok = true;
+	for (unsigned j = 0; j < vars.size() && ok; j++) {
+		ok = parseNumber(q, lineEnd, vars[j][i]);
+	}
+	ok = ok && parseNumber(q, lineEnd, targets[i]);
+	// nothing else on the line
+	while (ok && q < lineEnd && isBlank(*q)) {
+		q++;
+	}
+	return ok && q == lineEnd;
+}
+
+/*
+ * Map the columns of a binary dataset.
+ */
+static int mapBinaryDataset(const std::string &filename, std::vector<DataColumn> &vars, DataColumn &targets) {
+
+	shared_ptr<MappedFile> file(new MappedFile());
+	if (!file->open(filename, true)) {
+		return -1;
+	}
+	BinaryDatasetHeader header;
+	if (!readBinaryHeader(*file, header) || header.rows > INT_MAX) {
+		return 1;
+	}
+	file->advise(MADV_WILLNEED, 0, file->size());
+
+	char *base = file->data() + header.dataOffset;
+	shared_ptr<void> owner = file;
+	vars.resize(header.columns - 1);
+	for (unsigned j = 0; j < vars.size(); j++) {
+		vars[j].view((double*) (base + j * header.columnBytes), header.rows, owner);
+	}
+	targets.view((double*) (base + vars.size() * header.columnBytes), header.rows, owner);
+	return 0;
+}
+
+bool writeBinaryDataset(const std::string &filename, const std::vector<DataColumn> &vars, const DataColumn &targets) {
+
+	BinaryDatasetHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_DATASET_MAGIC, sizeof(header.magic));
+	header.version = BINARY_DATASET_VERSION;
+	header.dtype = BINARY_DATASET_FLOAT64;
+	header.rows = targets.size();
+	header.columns = vars.size() + 1;
+	header.columnBytes = (header.rows * sizeof(double) + BINARY_DATASET_ALIGN - 1) / BINARY_DATASET_ALIGN * BINARY_DATASET_ALIGN;
+	header.dataOffset = sizeof(header);
+
+	ofstream out(filename.c_str(), ios::binary | ios::trunc);
+	out.write((const char*) &header, sizeof(header));
+	vector<char> padding(header.columnBytes - header.rows * sizeof(double), 0);
+	for (unsigned j = 0; j <= vars.size(); j++) {
+		const DataColumn &column = (j < vars.size()) ? vars[j] : targets;
+		out.write((const char*) column.data(), header.rows * sizeof(double));
+		out.write(padding.data(), padding.size());
+	}
+	out.close();
+	return !out.fail();
+}
+
+bool writeTextDataset(const std::string &filename, const std::vector<DataColumn> &vars, const DataColumn &targets) {
+
+	ofstream out(filename.c_str(), ios::trunc);
+	long ncases = targets.size();
+	out << "# " << ncases << " " << vars.size() + 1 << "\n";
+
+	// a batch of blocks at a time, so memory use doesn't grow with the data
+	int batch = 4 * workerPool().getNumThreads();
+	long numBlocks = (ncases + DATA_WRITE_CASES - 1) / DATA_WRITE_CASES;
+	vector<string> text(batch);
+	for (long first = 0; first < numBlocks && out; first += batch) {
+		int n = (int) min((long) batch, numBlocks - first);
+		workerPool().run(n, [&](int b) {
+			long begin = (first + b) * DATA_WRITE_CASES;
+			long end = min(ncases, begin + DATA_WRITE_CASES);
+			string &s = text[b];
+			s.clear();
+			char value[32];
+			for (long i = begin; i < end; i++) {
+				for (unsigned j = 0; j <= vars.size(); j++) {
+					double v = (j < vars.size()) ? vars[j][i] : targets[i];
+					int k = snprintf(value, sizeof(value), (j < vars.size()) ? "%.17g " : "%.17g\n", v);
+					s.append(value, k);
+				}
+			}
+		});
+		for (int b = 0; b < n; b++) {
+			out.write(text[b].data(), text[b].size());
+		}
+	}
+	out.close();
+	return !out.fail();
+}
+
+int readDataset(const std::string &filename, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader) {
+
+	MappedFile file;
+	if (!file.open(filename)) {
+		return -1;
+	}
+	if (isBinary(file)) {
+		hasHeader = true;
+		return mapBinaryDataset(filename, vars, targets);
+	}
+	file.advise(MADV_SEQUENTIAL, 0, file.size());
+	const char *end = file.data() + file.size();
+
+	long ncases;
+	int nvars;
+	const char *body;
+	if (!readTextHeader(file, ncases, nvars, hasHeader, body)) {
+		return 1;
+	}
+
+	vars.resize(nvars);
+	for (int j = 0; j < nvars; j++) {
+		vars[j].resize(ncases);
+	}
+	targets.resize(ncases);
+
+	// cut the text into chunks of whole lines
+	vector<const char*> bounds;
+	bounds.push_back(body);
+	while (bounds.back() < end) {
+		const char *b = bounds.back() + DATA_CHUNK_BYTES;
+		bounds.push_back(b >= end ? end : nextLine(b, end));
+	}
+	int numChunks = bounds.size() - 1;
+	vector<double> costs(numChunks);
+	for (int c = 0; c < numChunks; c++) {
+		costs[c] = bounds[c + 1] - bounds[c];
+	}
+
+	// first, the number of cases in each chunk, so every chunk knows
+	// where its cases go
+	vector<long> firstCase(numChunks + 1, 0);
+	workerPool().run(costs, [&](int c) {
+		long n = 0;
+		for (const char *q = bounds[c]; q < bounds[c + 1]; q = nextLine(q, bounds[c + 1])) {
+			n += !blankLine(q, bounds[c + 1]);
+		}
+		firstCase[c + 1] = n;
+	});
+	for (int c = 0; c < numChunks; c++) {
+		firstCase[c + 1] += firstCase[c];
+	}
+
+	// then the values, straight into their columns
+	vector<long> firstBad(numChunks, LONG_MAX);
+	workerPool().run(costs, [&](int c) {
+		long i = firstCase[c];
+		const char *chunkEnd = bounds[c + 1];
+		for (const char *q = bounds[c]; q < chunkEnd && i < ncases; ) {
+			const char *eol = nextLine(q, chunkEnd);
+			if (blankLine(q, chunkEnd)) {
+				q = eol;
+				continue;
+			}
+			const char *lineEnd = (eol[-1] == '\n') ? eol - 1 : eol;
+			if (!parseCase(q, lineEnd, vars, targets, i)) {
+				firstBad[c] = i;
+				return;
+			}
+			q = eol;
+			i++;
+		}
+	});
+
+	long bad = firstCase[numChunks];	// the first case missing from the file, if any
+	for (int c = 0; c < numChunks; c++) {
+		bad = min(bad, firstBad[c]);
+	}
+	return (bad < ncases) ? bad + 1 : 0;
+}
+
+//
+// DatasetStream
+//
+
+DatasetStream::DatasetStream() {
+	binary = false;
+	numCases = 0;
+	numVariables = 0;
+	chunkCases = 1;
+	numChunks = 0;
+	body = 0;
+	cursor = 0;
+	cursorCase = 0;
+	prefetched = -1;
+	prefetchResult = 0;
+	chunks[0].chunk = chunks[1].chunk = -1;
+}
+
+DatasetStream::~DatasetStream() {
+	if (reader.joinable()) {
+		reader.join();
+	}
+}
+
+int DatasetStream::open(const std::string &filename, long chunkCases, bool &hasHeader) {
+
+	// read-only: nothing writes to the training data while it is streamed,
+	// and a private, writable mapping of a file bigger than memory may be
+	// refused
+	file.reset(new MappedFile());
+	if (!file->open(filename)) {
+		return -1;
+	}
+	binary = isBinary(*file);
+	if (binary) {
+		hasHeader = true;
+		if (!readBinaryHeader(*file, header)) {
+			return 1;
+		}
+		numCases = header.rows;
+		numVariables = header.columns - 1;
+	}
+	else {
+		if (!readTextHeader(*file, numCases, numVariables, hasHeader, body)) {
+			return 1;
+		}
+		cursor = body;
+		cursorCase = 0;
+		file->advise(MADV_SEQUENTIAL, 0, file->size());
+	}
+
+	this->chunkCases = max(chunkCases, 1L);
+	numChunks = (numCases + this->chunkCases - 1) / this->chunkCases;
+	for (int s = 0; s < 2; s++) {
+		chunks[s].chunk = -1;
+		chunks[s].vars.resize(numVariables);
+		if (!binary) {
+			chunks[s].values.reset(new vector<double>((numVariables + 1) * min(numCases, this->chunkCases)));
+		}
+	}
+	return 0;
+}
+
+long DatasetStream::getNumCases() const {
+	return numCases;
+}
+
+int DatasetStream::getNumVariables() const {
+	return numVariables;
+}
+
+int DatasetStream::getNumChunks() const {
+	return numChunks;
+}
+
+/*
+ * Read a chunk into chunks[chunk % 2].
+ */
+long DatasetStream::read(int chunk) {
+
+	Chunk &c = chunks[chunk % 2];
+	if (c.chunk == chunk) {
+		return 0;		// still there from the last pass
+	}
+	c.chunk = -1;
+	long first = (long) chunk * chunkCases;
+	long n = min(chunkCases, numCases - first);
+
+	if (binary) {
+		// touch every page, so the chunk is in memory when it is used
+		static const size_t pageSize = sysconf(_SC_PAGESIZE);
+		shared_ptr<void> owner = file;
+		volatile char sum = 0;
+		for (int j = 0; j <= numVariables; j++) {
+			const char *values = file->data() + header.dataOffset + j * header.columnBytes + first * sizeof(double);
+			for (size_t b = 0; b < n * sizeof(double); b += pageSize) {
+				sum += values[b];
+			}
+			DataColumn &column = (j < numVariables) ? c.vars[j] : c.targets;
+			column.view((double*) values, n, owner);
+		}
+		c.chunk = chunk;
+		return 0;
+	}
+
+	// the columns are views of the chunk's buffer
+	long stride = c.values->size() / (numVariables + 1);
+	for (int j = 0; j <= numVariables; j++) {
+		DataColumn &column = (j < numVariables) ? c.vars[j] : c.targets;
+		column.view(&(*c.values)[j * stride], n, c.values);
+	}
+
+	// text has to be read in order: go back to the start if need be, and
+	// skip any chunks in between
+	const char *end = file->data() + file->size();
+	if (cursorCase > first) {
+		cursor = body;
+		cursorCase = 0;
+	}
+	for (; cursorCase < first && cursor < end; cursor = nextLine(cursor, end)) {
+		cursorCase += !blankLine(cursor, end);
+	}
+
+	c.textBegin = cursor - file->data();
+	for (long i = 0; i < n; ) {
+		if (cursor >= end) {
+			return first + i + 1;
+		}
+		const char *eol = nextLine(cursor, end);
+		if (!blankLine(cursor, end)) {
+			const char *lineEnd = (eol[-1] == '\n') ? eol - 1 : eol;
+			if (!parseCase(cursor, lineEnd, c.vars, c.targets, i)) {
+				return first + i + 1;
+			}
+			i++;
+		}
+		cursor = eol;
+	}
+	cursorCase = first + n;
+	c.textEnd = cursor - file->data();
+	c.chunk = chunk;
+	return 0;
+}
+
+/*
+ * Give back the pages of a chunk that has been used.
+ */
+void DatasetStream::release(const Chunk &c) {
+
+	if (!binary) {
+		file->advise(MADV_DONTNEED, c.textBegin, c.textEnd - c.textBegin);
+		return;
+	}
+	long first = (long) c.chunk * chunkCases;
+	for (int j = 0; j <= numVariables; j++) {
+		file->advise(MADV_DONTNEED, header.dataOffset + j * header.columnBytes + first * sizeof(double), c.targets.size() * sizeof(double));
+	}
+}
+
+void DatasetStream::prefetch(int chunk) {
+
+	if (chunk < 0 || chunk >= numChunks || prefetched >= 0) {
+		return;
+	}
+	prefetched = chunk;
+	reader = thread([this, chunk]() {
+		prefetchResult = read(chunk);
+	});
+}
+
+long DatasetStream::fetch(int chunk, std::vector<DataColumn> &vars, DataColumn &targets) {
+
+	long bad;
+	if (prefetched >= 0) {
+		reader.join();
+	}
+	bad = (prefetched == chunk) ? prefetchResult : read(chunk);
+	prefetched = -1;
+
+	// the chunk before is done with
+	const Chunk &before = chunks[(chunk + 1) % 2];
+	if (before.chunk >= 0 && before.chunk != chunk && bad == 0) {
+		release(before);
+	}
+
+	vars = chunks[chunk % 2].vars;
+	targets = chunks[chunk % 2].targets;
+	return bad;
+}
@@ -0,0 +1,240 @@
+/** \file dataio.h
+ * Reading datasets.
+ *
+ * A dataset file starts with a header line "# ncases nvars" (nvars counts
+ * the target) followed by one fitness case per line: the values of the
+ * variables, then the target, separated by white space. Files are memory
+ * mapped and parsed by several threads at once, each taking a chunk of
+ * lines, with a hand-written number parser that is exact (it gives the same
+ * doubles as the C library's strtod) and doesn't depend on the locale.
+ *
+ * For big datasets there is also a binary, columnar format, written by
+ * "gpsr convert" from the text format. It is a 64-byte header (see
+ * BinaryDatasetHeader) followed by one block per column, the variables in
+ * order and then the targets, each holding the values of every fitness case
+ * as little-endian doubles and starting on a 64-byte boundary. The file is
+ * mapped (copy-on-write) and its columns are used where they lie, so loading
+ * costs no parsing and no copying, and pages are only read as the evaluation
+ * touches them.
+ *
+ * Datasets too big for memory can be read a chunk of fitness cases at a
+ * time instead (DatasetStream).
+ */
+
+#ifndef DATAIO_H
+#define DATAIO_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include <memory>
+#include <thread>
+
+#include "global.h"
+
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedFile {
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		/**
+		 * Map a file.
+		 * @param filename the file
+		 * @param writable map it copy-on-write, so it can be changed (in
+		 * this process only)
+		 * @return false if it can't be opened or mapped
+		 */
+		bool open(const std::string &filename, bool writable = false);
+
+		/**
+		 * @return the contents of the file (not terminated by a null)
+		 */
+		const char* data() const;
+		char* data();
+
+		/**
+		 * @return the size of the file in bytes
+		 */
+		size_t size() const;
+
+		/**
+		 * Tell the system how part of the file is going to be used.
+		 * @param advice as for madvise (e.g. MADV_WILLNEED, MADV_DONTNEED)
+		 * @param offset where the part starts
+		 * @param bytes the size of the part
+		 */
+		void advise(int advice, size_t offset, size_t bytes);
+
+	private:
+		MappedFile(const MappedFile &);		// not copyable
+		void operator=(const MappedFile &);
+
+		char *start;
+		size_t length;
+};
+
+/**
+ * Parse a number (as written by printf or iostreams, including inf and
+ * nan) starting at p, after any blanks. The result is exactly what strtod
+ * would give.
+ * @param p where to start; set to just after the number
+ * @param end the end of the text
+ * @param value set to the number
+ * @return false if there is no number at p
+ */
+bool parseNumber(const char *&p, const char *end, double &value);
+
+/* the binary dataset format */
+#define BINARY_DATASET_MAGIC "GPSRCOLS"
+#define BINARY_DATASET_VERSION 1
+#define BINARY_DATASET_FLOAT64 1	// little-endian IEEE doubles (the only dtype so far)
+#define BINARY_DATASET_ALIGN 64
+
+/**
+ * The header of a binary dataset (all fields little-endian).
+ */
+struct BinaryDatasetHeader {
+	char magic[8];		// BINARY_DATASET_MAGIC
+	uint32_t version;	// BINARY_DATASET_VERSION
+	uint32_t dtype;		// BINARY_DATASET_FLOAT64
+	uint64_t rows;		// number of fitness cases
+	uint64_t columns;	// number of variables + 1 (the targets)
+	uint64_t columnBytes;	// from the start of one column to the next
+	uint64_t dataOffset;	// start of the first column
+	char reserved[16];
+};
+
+/**
+ * Read a dataset, in either the text or the binary format (told apart by
+ * the first bytes of the file). The columns of a binary dataset are views of
+ * the mapped file.
+ * @param filename the file
+ * @param vars set to the variables, one column per variable
+ * @param targets set to the targets
+ * @param hasHeader set to false if a text file's header line doesn't start with #
+ * @return 0 if all went well, the number (from 1) of the first fitness case
+ * that could not be read (1 for a binary file that is damaged or cut short),
+ * or -1 if the file could not be opened
+ */
+int readDataset(const std::string &filename, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader);
+
+/**
+ * Write a dataset in the binary format.
+ * @param filename the file
+ * @param vars the variables
+ * @param targets the targets
+ * @return false if the file could not be written
+ */
+bool writeBinaryDataset(const std::string &filename, const std::vector<DataColumn> &vars, const DataColumn &targets);
+
+/**
+ * Write a dataset in the text format, with the values in full (they read
+ * back as the same doubles).
+ * @param filename the file
+ * @param vars the variables
+ * @param targets the targets
+ * @return false if the file could not be written
+ */
+bool writeTextDataset(const std::string &filename, const std::vector<DataColumn> &vars, const DataColumn &targets);
+
+/**
+ * Reads a dataset (in either format) a chunk of fitness cases at a time, so
+ * that only a couple of chunks need to be in memory however big the file.
+ * The next chunk can be read on a background thread while the current one is
+ * in use, and the pages of chunks that have been used are given back to the
+ * system. Chunks of a binary dataset are views of the mapped file; text is
+ * parsed into two buffers which take turns.
+ */
+class DatasetStream {
+
+	public:
+		DatasetStream();
+
+		/**
+		 * Destructor. Waits for a background read to finish.
+		 */
+		~DatasetStream();
+
+		/**
+		 * Open a dataset. Text is only checked as its chunks are read.
+		 * @param filename the file
+		 * @param chunkCases the number of fitness cases in a chunk
+		 * @param hasHeader set to false if a text file's header line doesn't start with #
+		 * @return as readDataset()
+		 */
+		int open(const std::string &filename, long chunkCases, bool &hasHeader);
+
+		/**
+		 * @return the number of fitness cases in the dataset
+		 */
+		long getNumCases() const;
+
+		/**
+		 * @return the number of variables
+		 */
+		int getNumVariables() const;
+
+		/**
+		 * @return the number of chunks
+		 */
+		int getNumChunks() const;
+
+		/**
+		 * Start reading a chunk on a background thread. Chunks are meant to
+		 * be read in order, each pass starting again from chunk 0.
+		 * @param chunk the chunk
+		 */
+		void prefetch(int chunk);
+
+		/**
+		 * Get a chunk, waiting for it if it is being prefetched (or reading
+		 * it if not). The pages of the chunk before are given back.
+		 * @param chunk the chunk
+		 * @param vars set to the chunk of each variable; valid until the
+		 * chunk after this one is fetched
+		 * @param targets set to the chunk of targets
+		 * @return 0 if all went well, or the number (from 1) of the first
+		 * fitness case that could not be read
+		 */
+		long fetch(int chunk, std::vector<DataColumn> &vars, DataColumn &targets);
+
+	private:
+		DatasetStream(const DatasetStream &);		// not copyable
+		void operator=(const DatasetStream &);
+
+		/* a chunk that has been read */
+		struct Chunk {
+			int chunk;
+			std::shared_ptr<std::vector<double> > values;	// text only
+			std::vector<DataColumn> vars;
+			DataColumn targets;
+			size_t textBegin, textEnd;	// text only
+		};
+
+		long read(int chunk);
+		void release(const Chunk &c);
+
+		std::shared_ptr<MappedFile> file;
+		bool binary;
+		BinaryDatasetHeader header;	// binary only
+		long numCases;
+		int numVariables;
+		long chunkCases;
+		int numChunks;
+
+		Chunk chunks[2];		// chunk c is read into chunks[c % 2]
+		const char *body;		// text only: the first fitness case
+		const char *cursor;		// text only: where the next chunk starts
+		long cursorCase;
+
+		std::thread reader;
+		int prefetched;			// the chunk being read in the background, or -1
+		long prefetchResult;
+};
+
+#endif
@@ -0,0 +1,463 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <climits>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "evalfarm.h"
+#include "serialize.h"
+#include "socketio.h"
+#include "threadpool.h"
+#include "global.h"
+#include "usefulfunctions.h"
+
+using namespace std;
+
+/* first words of the messages between master and workers */
+#define FARM_HELLO   0x48465347	// "GSFH"
+#define FARM_BATCH   0x42465347	// "GSFB"
+#define FARM_RESULTS 0x52465347	// "GSFR"
+
+/* how many batches each worker gets per evaluation, and may have outstanding */
+#define FARM_BATCHES_PER_WORKER 4
+#define FARM_MAX_IN_FLIGHT 2
+
+/* a worker that hasn't answered for this long is given up */
+#define FARM_TIMEOUT_MS 60000
+
+/* how long a local worker may take to load the data and start listening */
+#define FARM_START_TIMEOUT_MS 60000
+
+static EvaluationFarm *farm = 0;
+
+static void hashBytes(unsigned long long &h, const void *p, size_t n) {
+	// FNV-1a
+	const unsigned char *c = (const unsigned char*) p;
+	for (size_t i = 0; i < n; i++) {
+		h ^= c[i];
+		h *= 0x100000001b3ULL;
+	}
+}
+
+unsigned long long setupDigest() {
+	unsigned long long h = 0xcbf29ce484222325ULL;
+
+	int ncases = targets.size();
+	hashBytes(h, &ncases, sizeof(ncases));
+	hashBytes(h, &numVariables, sizeof(numVariables));
+	for (unsigned v = 0; v < variables.size(); v++) {
+		hashBytes(h, variables[v].data(), variables[v].size() * sizeof(double));
+	}
+	hashBytes(h, targets.data(), targets.size() * sizeof(double));
+	hashBytes(h, &constants[0], constants.size() * sizeof(double));
+	hashBytes(h, &config->linear_scaling, sizeof(config->linear_scaling));
+	hashBytes(h, &shardSize, sizeof(shardSize));
+	return h;
+}
+
+//
+// master side
+//
+
+EvaluationFarm::EvaluationFarm(const std::vector<std::string> &addresses) {
+	this->population = 0;
+	this->applyScaling = 0;
+	this->batchSize = 1;
+	this->workingAlone = false;
+
+	for (unsigned i = 0; i < addresses.size(); i++) {
+		Worker w;
+		w.address = addresses[i];
+		w.fd = -1;
+		w.rejected = false;
+		w.pid = 0;
+		if (!connectWorker(w) && !w.rejected) {
+			cerr << "Could not connect to evaluation worker " << w.address << endl;
+		}
+		workers.push_back(w);
+	}
+}
+
+EvaluationFarm::~EvaluationFarm() {
+	for (unsigned i = 0; i < workers.size(); i++) {
+		closeSocket(workers[i].fd);
+		if (workers[i].pid > 0) {
+			kill(workers[i].pid, SIGTERM);
+			waitpid(workers[i].pid, 0, 0);
+			unlink(workers[i].address.substr(5).c_str());
+		}
+	}
+}
+
+bool EvaluationFarm::startLocalWorkers(int n, char* argv[]) {
+
+	// gpsr-worker lives next to gpsr
+	string dir = ".";
+	char exe[PATH_MAX];
+	ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	string self = (len > 0) ? string(exe, len) : string(argv[0]);
+	if (self.rfind('/') != string::npos) {
+		dir = self.substr(0, self.rfind('/'));
+	}
+	string binary = dir + "/gpsr-worker";
+
+	for (int k = 0; k < n; k++) {
+		Worker w;
+		w.address = "unix:/tmp/gpsr-worker-" + intToString(getpid()) + "-" + intToString(k) + ".sock";
+		w.fd = -1;
+		w.rejected = false;
+
+		// the worker gets the master's options, after its address
+		vector<char*> args;
+		args.push_back((char*) binary.c_str());
+		args.push_back((char*) w.address.c_str());
+		for (int i = 1; argv[i] != 0; i++) {
+			args.push_back(argv[i]);
+		}
+		args.push_back(0);
+
+		w.pid = fork();
+		if (w.pid < 0) {
+			cerr << "Could not start an evaluation worker: " << strerror(errno) << endl;
+			return false;
+		}
+		if (w.pid == 0) {
+#ifdef __linux__
+			// don't outlive the master
+			prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+			// keep the master's output readable
+			if (freopen("/dev/null", "w", stdout) == 0) {
+				_exit(127);
+			}
+			execv(binary.c_str(), &args[0]);
+			cerr << "Could not run " << binary << ": " << strerror(errno) << endl;
+			_exit(127);
+		}
+		workers.push_back(w);
+	}
+
+	// wait for them to load the data and start listening
+	for (unsigned i = 0; i < workers.size(); i++) {
+		Worker &w = workers[i];
+		if (w.pid <= 0) {
+			continue;
+		}
+		for (int waited = 0; !connectWorker(w); waited += 20) {
+			if (w.rejected || waitpid(w.pid, 0, WNOHANG) == w.pid || waited > FARM_START_TIMEOUT_MS) {
+				cerr << "Evaluation worker " << w.address << " did not start" << endl;
+				w.pid = 0;
+				return false;
+			}
+			usleep(20000);
+		}
+	}
+	return true;
+}
+
+bool EvaluationFarm::connectWorker(Worker &w) {
+
+	if (w.rejected) {
+		return false;
+	}
+	w.fd = connectTo(w.address);
+	if (w.fd < 0) {
+		return false;
+	}
+
+	// make sure the worker would compute the same fitness as we would
+	ByteWriter hello;
+	hello.putU32(FARM_HELLO);
+	hello.putU64(setupDigest());
+	string reply;
+	if (!sendMessage(w.fd, hello.data()) || !waitReadable(w.fd, FARM_TIMEOUT_MS) || !recvMessage(w.fd, reply)) {
+		closeSocket(w.fd);
+		w.fd = -1;
+		return false;
+	}
+	ByteReader r(reply);
+	if (r.getU32() != FARM_HELLO || r.getU8() != 1 || !r.ok()) {
+		cerr << "Evaluation worker " << w.address << " has different data or settings; not using it" << endl;
+		closeSocket(w.fd);
+		w.fd = -1;
+		w.rejected = true;
+		return false;
+	}
+	return true;
+}
+
+void EvaluationFarm::loseWorker(Worker &w, std::deque<int> &pending) {
+	cerr << "Lost evaluation worker " << w.address << "; retrying its work elsewhere" << endl;
+	closeSocket(w.fd);
+	w.fd = -1;
+	// its batches go to the front of the queue
+	while (!w.inFlight.empty()) {
+		pending.push_front(w.inFlight.back());
+		w.inFlight.pop_back();
+	}
+}
+
+bool EvaluationFarm::sendBatch(Worker &w, int batch) {
+	int begin = batch * batchSize;
+	int end = min(begin + batchSize, (int) population->size());
+
+	ByteWriter msg;
+	msg.putU32(FARM_BATCH);
+	msg.putVarint(batch);
+	msg.putVarint(end - begin);
+	for (int i = begin; i < end; i++) {
+		msg.putU8((*applyScaling)[i] ? 1 : 0);
+		writeProgram(msg, *((*population)[i]));
+	}
+	return sendMessage(w.fd, msg.data());
+}
+
+bool EvaluationFarm::receiveResults(Worker &w) {
+	string reply;
+	if (!recvMessage(w.fd, reply)) {
+		return false;
+	}
+
+	// workers answer in order
+	int batch = w.inFlight.front();
+	int begin = batch * batchSize;
+	int end = min(begin + batchSize, (int) population->size());
+
+	ByteReader r(reply);
+	if (r.getU32() != FARM_RESULTS || (int) r.getVarint() != batch || (int) r.getVarint() != end - begin) {
+		return false;
+	}
+	vector<double> results(3 * (end - begin));
+	for (unsigned k = 0; k < results.size(); k++) {
+		results[k] = r.getDouble();
+	}
+	if (!r.ok()) {
+		return false;
+	}
+	for (int i = begin; i < end; i++) {
+		GPProgram *gpr = (*population)[i];
+		gpr->setFitness(results[3 * (i - begin)]);
+		gpr->setLSCoeffA(results[3 * (i - begin) + 1]);
+		gpr->setLSCoeffB(results[3 * (i - begin) + 2]);
+	}
+	w.inFlight.pop_front();
+	return true;
+}
+
+void EvaluationFarm::evaluate(const std::vector<GPProgram*> &population, const std::vector<char> &applyScaling) {
+
+	// try again with workers lost last time
+	for (unsigned i = 0; i < workers.size(); i++) {
+		if (workers[i].fd < 0) {
+			connectWorker(workers[i]);
+		}
+	}
+
+	if (getNumWorkers() > 0) {
+		workingAlone = false;
+	}
+
+	this->population = &population;
+	this->applyScaling = &applyScaling;
+	int live = max(getNumWorkers(), 1);
+	batchSize = max(1, (int) population.size() / (live * FARM_BATCHES_PER_WORKER));
+	int numBatches = (population.size() + batchSize - 1) / batchSize;
+
+	deque<int> pending;
+	for (int b = 0; b < numBatches; b++) {
+		pending.push_back(b);
+	}
+
+	int done = 0;
+	while (done < numBatches) {
+
+		// hand out work, as far as the workers' windows allow
+		vector<struct pollfd> fds;
+		vector<int> polled;
+		for (unsigned i = 0; i < workers.size(); i++) {
+			Worker &w = workers[i];
+			while (w.fd >= 0 && w.inFlight.size() < FARM_MAX_IN_FLIGHT && !pending.empty()) {
+				w.inFlight.push_back(pending.front());
+				pending.pop_front();
+				if (!sendBatch(w, w.inFlight.back())) {
+					loseWorker(w, pending);
+				}
+			}
+			if (w.fd >= 0 && !w.inFlight.empty()) {
+				struct pollfd pfd = { w.fd, POLLIN, 0 };
+				fds.push_back(pfd);
+				polled.push_back(i);
+			}
+		}
+
+		if (fds.empty()) {
+			// nobody left to do the work: do it ourselves
+			if (!workingAlone) {
+				cerr << "No evaluation workers left; evaluating locally" << endl;
+				workingAlone = true;
+			}
+			while (!pending.empty()) {
+				int begin = pending.front() * batchSize;
+				int end = min(begin + batchSize, (int) population.size());
+				for (int i = begin; i < end; i++) {
+					population[i]->calcFitness(true, applyScaling[i]);
+				}
+				pending.pop_front();
+				done++;
+			}
+			break;
+		}
+
+		int ready = poll(&fds[0], fds.size(), FARM_TIMEOUT_MS);
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		for (unsigned k = 0; k < fds.size(); k++) {
+			Worker &w = workers[polled[k]];
+			if (ready == 0) {
+				// nobody has answered for ages
+				loseWorker(w, pending);
+			}
+			else if (fds[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+				if (receiveResults(w)) {
+					done++;
+				}
+				else {
+					loseWorker(w, pending);
+				}
+			}
+		}
+	}
+
+	this->population = 0;
+	this->applyScaling = 0;
+}
+
+int EvaluationFarm::getNumWorkers() const {
+	int n = 0;
+	for (unsigned i = 0; i < workers.size(); i++) {
+		if (workers[i].fd >= 0) {
+			n++;
+		}
+	}
+	return n;
+}
+
+void startEvaluationFarm(char* argv[]) {
+	farm = new EvaluationFarm(farm_workers);
+	if (localWorkers > 0 && !farm->startLocalWorkers(localWorkers, argv)) {
+		delete farm;
+		exit(1);
+	}
+}
+
+void stopEvaluationFarm() {
+	delete farm;
+	farm = 0;
+}
+
+EvaluationFarm* evaluationFarm() {
+	return farm;
+}
+
+//
+// worker side
+//
+
+/*
+ * Answer one request from a master.
+ * @return false if the request made no sense
+ */
+static bool handleRequest(const std::string &request, ByteWriter &reply) {
+
+	ByteReader r(request);
+	unsigned int type = r.getU32();
+
+	if (type == FARM_HELLO) {
+		reply.putU32(FARM_HELLO);
+		reply.putU8(r.getU64() == setupDigest() ? 1 : 0);
+		return r.ok();
+	}
+
+	if (type != FARM_BATCH) {
+		return false;
+	}
+
+	int batch = r.getVarint();
+	int count = r.getVarint();
+	if (!r.ok() || count < 0 || (size_t) count > r.remaining()) {
+		return false;
+	}
+	vector<GPProgram> progs(count);
+	vector<char> scaling(count);
+	for (int i = 0; i < count; i++) {
+		scaling[i] = r.getU8();
+		if (!readProgram(r, progs[i])) {
+			return false;
+		}
+	}
+
+	workerPool().run(count, [&](int i) {
+		progs[i].calcFitness(true, scaling[i]);
+	});
+
+	reply.putU32(FARM_RESULTS);
+	reply.putVarint(batch);
+	reply.putVarint(count);
+	for (int i = 0; i < count; i++) {
+		reply.putDouble(progs[i].getFitness());
+		reply.putDouble(progs[i].getLSCoeffA());
+		reply.putDouble(progs[i].getLSCoeffB());
+	}
+	return true;
+}
+
+void serveEvaluations(const std::string &address) {
+
+	int listenFd = listenOn(address);
+	if (listenFd < 0) {
+		return;
+	}
+
+	vector<int> masters;
+	for (;;) {
+		vector<struct pollfd> fds;
+		struct pollfd lfd = { listenFd, POLLIN, 0 };
+		fds.push_back(lfd);
+		for (unsigned i = 0; i < masters.size(); i++) {
+			struct pollfd pfd = { masters[i], POLLIN, 0 };
+			fds.push_back(pfd);
+		}
+		if (poll(&fds[0], fds.size(), -1) <= 0) {
+			continue;
+		}
+
+		vector<int> alive;
+		for (unsigned i = 1; i < fds.size(); i++) {
+			int fd = fds[i].fd;
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				string request;
+				ByteWriter reply;
+				if (!recvMessage(fd, request) || !handleRequest(request, reply) || !sendMessage(fd, reply.data())) {
+					closeSocket(fd);
+					continue;
+				}
+			}
+			alive.push_back(fd);
+		}
+
+		if (fds[0].revents & POLLIN) {
+			int fd = acceptConnection(listenFd);
+			if (fd >= 0) {
+				alive.push_back(fd);
+			}
+		}
+		masters = alive;
+	}
+}
@@ -0,0 +1,124 @@
+/**
+ * EvaluationFarm class.
+ *
+ * Farms the fitness evaluation of a population out to gpsr-worker processes
+ * (see workerprog.cpp), for datasets so expensive that one machine can't keep
+ * up. A worker loads the training data once and then serves batches of
+ * individuals (in the encoding of serialize.h) over a socket, answering with
+ * their fitness and LS coefficients; the evolutionary loop stays in the
+ * master.
+ *
+ * The population is cut into batches which are pipelined to the workers,
+ * each having at most FARM_MAX_IN_FLIGHT batches outstanding at a time so a
+ * slow worker is never buried in work. If a worker fails or stops answering,
+ * its outstanding batches are handed to the others (or, with no workers
+ * left, evaluated locally), and it is reconnected before the next
+ * evaluation. Since the workers run the same code on the same data, results
+ * are identical to evaluating locally.
+ *
+ * A worker must be started with the same data and settings as the master;
+ * this is checked when connecting. In the localhost mode (--local-workers)
+ * the master starts the workers itself, with its own options.
+ *
+ */
+
+#ifndef EVALFARM_H
+#define EVALFARM_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <sys/types.h>
+
+#include "gpprogram.h"
+
+class EvaluationFarm {
+
+	public:
+		/**
+		 * Constructor. Connects to running workers.
+		 * @param addresses the workers' addresses (unix:/path or host:port)
+		 */
+		EvaluationFarm(const std::vector<std::string> &addresses);
+
+		/**
+		 * Destructor. Disconnects, and stops any local workers.
+		 */
+		~EvaluationFarm();
+
+		/**
+		 * Start workers on this machine, listening on Unix-domain sockets.
+		 * @param n the number of workers
+		 * @param argv the options to start them with (the master's own)
+		 * @return false if a worker could not be started
+		 */
+		bool startLocalWorkers(int n, char* argv[]);
+
+		/**
+		 * Evaluate individuals on the training data, as
+		 * GPProgram::calcFitness(true, applyScaling[i]) would.
+		 * @param population the individuals
+		 * @param applyScaling whether to recompute each one's LS coefficients
+		 */
+		void evaluate(const std::vector<GPProgram*> &population, const std::vector<char> &applyScaling);
+
+		/**
+		 * @return the number of workers currently connected
+		 */
+		int getNumWorkers() const;
+
+	private:
+		struct Worker {
+			std::string address;
+			int fd;
+			bool rejected;			// started with different data/settings
+			pid_t pid;			// local workers only
+			std::deque<int> inFlight;	// batches sent, oldest first
+		};
+
+		bool connectWorker(Worker &w);
+		void loseWorker(Worker &w, std::deque<int> &pending);
+		bool sendBatch(Worker &w, int batch);
+		bool receiveResults(Worker &w);
+
+		std::vector<Worker> workers;
+
+		// the job being evaluated
+		const std::vector<GPProgram*> *population;
+		const std::vector<char> *applyScaling;
+		int batchSize;
+		bool workingAlone;		// no workers left (said so once)
+};
+
+/**
+ * Set up the evaluation farm asked for with --workers/--local-workers.
+ * @param argv the program's options (passed on to local workers)
+ */
+void startEvaluationFarm(char* argv[]);
+
+/**
+ * Shut the evaluation farm down.
+ */
+void stopEvaluationFarm();
+
+/**
+ * @return the evaluation farm, or 0 if fitness is evaluated locally
+ */
+EvaluationFarm* evaluationFarm();
+
+/**
+ * A fingerprint of everything a fitness value depends on: the training data,
+ * the constants, and the scaling and shard settings. Master and workers
+ * compare fingerprints when they connect.
+ * @return the fingerprint
+ */
+unsigned long long setupDigest();
+
+/**
+ * Serve evaluation requests from masters (the body of gpsr-worker). Only
+ * returns if the address can't be listened on.
+ * @param address where to listen
+ */
+void serveEvaluations(const std::string &address);
+
+#endif
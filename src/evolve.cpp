@@ -0,0 +1,107 @@
+#include <iostream>
+#include "evolve.h"
+#include "gpoperators.h"
+#include "global.h"
+#include "timing.h"
+#include "perfcounters.h"
+#include "trace.h"
+
+using namespace std;
+
+GenerationResult evaluateBest(GPPopulation &pop) {
+
+	TIME_PHASE(PHASE_TEST);
+	GenerationResult ret;
+	GPProgram *best = pop.getIndividual(pop.getIndexOfBest());
+
+	ret.trainPerf = best->getFitness();
+	ret.testPerf = best->getTestFitness();
+	ret.trainHits = best->getNumberOfHits(config->hitsCriterion, true);
+	ret.testHits = best->getNumberOfHits(config->hitsCriterion, false);
+	return ret;
+}
+
+GenerationResult evolveGeneration(GPPopulation &pop, int generation, ulong streamSeed) {
+
+	TRACE_SPAN("generation", generation);
+	GenerationResult ret;
+
+	// update global current gen counter
+	currentgen = generation;
+
+	int best1 = pop.getIndexOfBest();
+	GPProgram *elite = new GPProgram(*(pop.getIndividual(best1)));
+	double fit1 = elite->getFitness();
+
+	// do operators
+	{
+		COUNT_PHASE(COUNTED_OPERATORS);
+		if (parallel_breeding) {
+			TIME_PHASE(PHASE_BREEDING);
+			parallelBreed(pop, streamSeed, generation);
+		}
+		else {
+			{
+				TIME_PHASE(PHASE_SELECTION);
+				tournamentSelection(pop);
+			}
+			{
+				TIME_PHASE(PHASE_CROSSOVER);
+				crossover(pop);
+			}
+			{
+				TIME_PHASE(PHASE_MUTATION);
+				mutation(pop);
+			}
+		}
+	}
+
+	// calculate fitness
+	{
+		COUNT_PHASE(COUNTED_FITNESS);
+		TIME_PHASE(PHASE_FITNESS);
+		pop.calculatePopulationFitness();
+	}
+
+	// elitism and the performance of the best (timed with the testing)
+	TIME_PHASE(PHASE_TEST);
+	int best2 = pop.getIndexOfBest();
+	double fit2 = pop.getIndividualFitness(best2);
+
+	if (fit1 < fit2) {
+
+		// selection and operators did not produce a beter
+		// individual, so we should keep the previous best.
+		// We do this by replacing the current worst with
+		// the old best
+
+		// find current worst
+		int worst = pop.getIndexOfWorst();
+
+		// update that individual with the previous best
+		pop.setIndividual(worst, elite);
+
+		// training and testing performance should  therefore
+		// be taken from the previous best
+		ret.trainPerf = fit1;
+		ret.testPerf = elite->getTestFitness();
+
+		// the previous best overwrites the old worst, so we update the indexes
+		pop.setIndexOfBest(worst);
+
+		// get the hits
+		ret.trainHits = pop.getIndividual(worst)->getNumberOfHits(config->hitsCriterion, true);
+		ret.testHits = pop.getIndividual(worst)->getNumberOfHits(config->hitsCriterion, false);
+	}
+	else {
+		ret.trainPerf = fit2;
+		ret.testPerf = pop.getIndividual(best2)->getTestFitness();
+
+		// get the hits
+		ret.trainHits = pop.getIndividual(best2)->getNumberOfHits(config->hitsCriterion, true);
+		ret.testHits = pop.getIndividual(best2)->getNumberOfHits(config->hitsCriterion, false);
+	}
+
+	delete elite;
+	return ret;
+}
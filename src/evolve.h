@@ -0,0 +1,44 @@
+/** \file evolve.h
+ * The generational loop.
+ * One generation of GP (breeding, fitness evaluation and elitism), shared
+ * by the single population run and the island model; see genlog.h for the
+ * logging of its results.
+ */
+
+#ifndef EVOLVE_H
+#define EVOLVE_H
+
+#include "gppopulation.h"
+#include "rng.h"
+
+/**
+ * The performance of the best individual of a generation.
+ */
+struct GenerationResult {
+	double trainPerf;	// training fitness (MSE)
+	double testPerf;	// testing fitness (MSE)
+	int trainHits;		// number of training hits
+	int testHits;		// number of testing hits
+};
+
+/**
+ * Gets the performance of the current best individual of a population
+ * (the fitness must already have been calculated).
+ * @param pop the population
+ * @return the performance of the best individual
+ */
+GenerationResult evaluateBest(GPPopulation &pop);
+
+/**
+ * Evolve a population by one generation: selection, crossover and mutation,
+ * fitness evaluation, and elitism (if the new generation has nothing better
+ * than the previous best, the previous best replaces the worst individual).
+ * @param pop the population
+ * @param generation the number of the generation being created
+ * @param streamSeed the base seed of the per-offspring random streams (only
+ * used when breeding in parallel)
+ * @return the performance of the best individual of the new generation
+ */
+GenerationResult evolveGeneration(GPPopulation &pop, int generation, ulong streamSeed);
+
+#endif
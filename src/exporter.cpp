@@ -0,0 +1,217 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <dlfcn.h>
+
+#include "exporter.h"
+#include "serialize.h"
+#include "dataio.h"
+#include "usefulfunctions.h"
+#include "global.h"
+
+using namespace std;
+
+/*
+ * A double as a C++ literal that reads back exactly.
+ */
+static string literal(double v) {
+	if (std::isnan(v)) {
+		return "std::numeric_limits<double>::quiet_NaN()";
+	}
+	if (std::isinf(v)) {
+		return (v > 0) ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+	}
+	ostringstream s;
+	s << setprecision(numeric_limits<double>::max_digits10) << v;
+	string ret = s.str();
+	if (ret.find_first_of(".en") == string::npos) {
+		ret += ".0";
+	}
+	return (v < 0) ? "(" + ret + ")" : ret;
+}
+
+/*
+ * The statements that evaluate a model, one per node (into t<node>), and
+ * then the prediction after end ("return" or "out[i] ="). Variable j is
+ * varPrefix j varSuffix.
+ */
+static void writeBody(std::ostream &os, const SavedModel &model, const string &indent, const string &varPrefix, const string &varSuffix, const string &end) {
+
+	static const char *binaryOps[] = { "+", "-", "*" };
+	static const char *unaryFunctions[] = { "", "std::cos", "std::sin", "gpsr_log" };
+
+	vector<int> stack;
+	for (unsigned i = 0; i < model.ops.size(); i++) {
+		int op = model.ops[i];
+		os << indent << "const double t" << i << " = ";
+		if (op == OP_VAR) {
+			os << varPrefix << model.data[i] << varSuffix;
+		}
+		else if (op == OP_CONSTANT) {
+			map<int, double>::const_iterator it = model.constants.find(model.data[i]);
+			os << literal(it != model.constants.end() ? it->second : 0.0);
+		}
+		else if (op >= OP_ADD && op <= OP_DIV) {
+			int y = stack.back();
+			stack.pop_back();
+			int x = stack.back();
+			stack.pop_back();
+			if (op == OP_DIV) {
+				os << "gpsr_div(t" << x << ", t" << y << ")";
+			}
+			else {
+				os << "t" << x << " " << binaryOps[op - OP_ADD] << " t" << y;
+			}
+		}
+		else {
+			int y = stack.back();
+			stack.pop_back();
+			if (op == OP_SQR) {
+				os << "t" << y << " * t" << y;
+			}
+			else {
+				os << unaryFunctions[op - OP_SQR] << "(t" << y << ")";
+			}
+		}
+		os << ";\n";
+		stack.push_back(i);
+	}
+	os << indent << end << " " << literal(model.lsCoeffA) << " + " << literal(model.lsCoeffB) << " * t" << stack.back() << ";\n";
+}
+
+void writeModelSource(std::ostream &os, const SavedModel &model, const std::string &name) {
+
+	os << "// A model exported by gpsr (training fitness " << literal(model.fitness) << ").\n";
+	os << "// Compile with -ffp-contract=off (and no -ffast-math) for exactly gpsr's predictions.\n";
+	os << "\n";
+	os << "#include <cmath>\n";
+	os << "#include <cstddef>\n";
+	os << "#include <limits>\n";
+	os << "\n";
+	os << "// gpsr's protected division and log\n";
+	os << "static inline double gpsr_div(double a, double b) {\n";
+	os << "\treturn (b == 0.0) ? 0.0 : a / b;\n";
+	os << "}\n";
+	os << "\n";
+	os << "static inline double gpsr_log(double a) {\n";
+	os << "\treturn (a <= 0.0) ? 0.0 : std::log(a);\n";
+	os << "}\n";
+	os << "\n";
+	os << "// the prediction for one case (x[j]: variable j)\n";
+	os << "extern \"C\" double " << name << "(const double *x) {\n";
+	writeBody(os, model, "\t", "x[", "]", "return");
+	os << "}\n";
+	os << "\n";
+	os << "// the predictions for n cases (columns[j][i]: variable j of case i)\n";
+	os << "extern \"C\" void " << name << "_batch(const double *const *columns, size_t n, double *out) {\n";
+	os << "\tfor (size_t i = 0; i < n; i++) {\n";
+	writeBody(os, model, "\t\t", "columns[", "][i]", "out[i] =");
+	os << "\t}\n";
+	os << "}\n";
+}
+
+/*
+ * A file name quoted for the shell.
+ */
+static string quoted(const string &s) {
+	string ret = "'";
+	for (unsigned i = 0; i < s.size(); i++) {
+		if (s[i] == '\'') {
+			ret += "'\\''";
+		}
+		else {
+			ret += s[i];
+		}
+	}
+	return ret + "'";
+}
+
+bool buildSharedObject(const std::string &source, const std::string &library) {
+	const char *cxx = getenv("CXX");
+	string command = string((cxx != 0 && *cxx != '\0') ? cxx : "c++")
+		+ " -O2 -ffp-contract=off -fPIC -shared -o " + quoted(library) + " " + quoted(source);
+	return system(command.c_str()) == 0;
+}
+
+long verifySharedObject(const std::string &library, const std::string &name, const SavedModel &model, const std::string &datafile, double &maxDiff) {
+
+	maxDiff = 0.0;
+	// a name without a slash would be looked for on the library path
+	string path = (library.find('/') == string::npos) ? "./" + library : library;
+	void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == 0) {
+		cerr << dlerror() << endl;
+		return -1;
+	}
+	typedef double (*ScalarFunction)(const double *);
+	typedef void (*BatchFunction)(const double *const *, size_t, double *);
+	ScalarFunction scalar = (ScalarFunction) dlsym(handle, name.c_str());
+	BatchFunction batch = (BatchFunction) dlsym(handle, (name + "_batch").c_str());
+	if (scalar == 0 || batch == 0) {
+		cerr << dlerror() << endl;
+		dlclose(handle);
+		return -1;
+	}
+
+	bool hasHeader;
+	if (readDataset(datafile, test_variables, test_targets, hasHeader) != 0) {
+		cerr << "Could not read " << datafile << endl;
+		dlclose(handle);
+		return -1;
+	}
+
+	// node lists with the model's own constants, so it is evaluated as saved
+	cleanup();
+	constants.clear();
+	for (map<int, double>::const_iterator it = model.constants.begin(); it != model.constants.end(); it++) {
+		if (it->first >= (int) constants.size()) {
+			constants.resize(it->first + 1, 0.0);
+		}
+		constants[it->first] = it->second;
+	}
+	for (unsigned i = 0; i < constants.size(); i++) {
+		t_constants.push_back(GPNode(i, "constant", -1));
+	}
+	numVariables = test_variables.size();
+	setupVariables();
+	setupBinaries();
+	unaries = "lsc2";
+	setupUnaries();
+
+	GPProgram prog;
+	if (!buildGenome(model.ops, model.data, model.constants, prog)) {
+		cerr << "The model needs variables " << datafile << " doesn't have" << endl;
+		dlclose(handle);
+		return -1;
+	}
+	ResultType guesses = prog.evaluate(false);
+
+	vector<const double*> columns;
+	for (unsigned j = 0; j < test_variables.size(); j++) {
+		columns.push_back(test_variables[j].data());
+	}
+	vector<double> out(guesses.size());
+	batch(columns.data(), out.size(), out.data());
+
+	// both functions must agree with gpsr
+	long differ = 0;
+	vector<double> x(test_variables.size());
+	for (unsigned i = 0; i < out.size(); i++) {
+		for (unsigned j = 0; j < x.size(); j++) {
+			x[j] = test_variables[j][i];
+		}
+		double one = scalar(x.data());
+		double expected = model.lsCoeffA + model.lsCoeffB * guesses[i];
+		bool same = (out[i] == expected || (std::isnan(out[i]) && std::isnan(expected)))
+			&& (one == expected || (std::isnan(one) && std::isnan(expected)));
+		if (!same) {
+			differ++;
+			maxDiff = max(maxDiff, max(fabs(out[i] - expected), fabs(one - expected)));
+		}
+	}
+	dlclose(handle);
+	return differ;
+}
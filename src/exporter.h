@@ -0,0 +1,60 @@
+/** \file exporter.h
+ * Exporting models as C++ source ("gpsr export").
+ *
+ * A model is written out as straight-line code (one statement per node of
+ * its genome) with its constants and LS coefficients as literals, in two
+ * functions with C linkage:
+ *
+ *     double name(const double *x);
+ *         the prediction for one case, x[j] being variable j
+ *     void name_batch(const double *const *columns, size_t n, double *out);
+ *         the predictions for n cases, columns[j] holding variable j
+ *
+ * Division and log are protected exactly as in gpsr (protectedDivision,
+ * protectedLog), so the code gives the same predictions as the model does
+ * in gpsr, as long as it is compiled without floating-point contraction or
+ * fast-math optimisations (-ffp-contract=off, as buildSharedObject() does).
+ */
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <string>
+#include <ostream>
+
+#include "model.h"
+
+/**
+ * Write a model as C++ source.
+ * @param os where to write it
+ * @param model the model
+ * @param name the name of the functions (a C identifier)
+ */
+void writeModelSource(std::ostream &os, const SavedModel &model, const std::string &name);
+
+/**
+ * Build exported source into a shared object with the system compiler
+ * ($CXX, or c++).
+ * @param source the source file
+ * @param library the shared object to build
+ * @return false if the compiler failed
+ */
+bool buildSharedObject(const std::string &source, const std::string &library);
+
+/**
+ * Check a shared object built from a model against the model itself: load
+ * its batch function and compare its predictions with those of
+ * GPProgram::evaluate on a dataset. This loads the dataset as the testing
+ * data and sets up the node lists for the model, so it is for programs
+ * that aren't evolving anything (gpsr export).
+ * @param library the shared object
+ * @param name the name of the functions
+ * @param model the model
+ * @param datafile the dataset
+ * @param maxDiff set to the largest difference between the predictions
+ * @return the number of cases whose predictions differ, or -1 if the check
+ * couldn't be made
+ */
+long verifySharedObject(const std::string &library, const std::string &name, const SavedModel &model, const std::string &datafile, double &maxDiff);
+
+#endif
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "genlog.h"
+#include "streaming.h"
+#include "global.h"
+#include "trace.h"
+
+using namespace std;
+
+//
+// the background writer
+//
+
+static mutex writerLock;		// the list of logs and the thread
+static condition_variable wake;
+static vector<GenerationLog*> openLogs;
+static thread writer;
+static bool stopping = false;
+
+static void writeLogs() {
+	setTraceThreadName("log writer");
+	unique_lock<mutex> l(writerLock);
+	while (!stopping) {
+		wake.wait_for(l, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+		for (unsigned i = 0; i < openLogs.size(); i++) {
+			openLogs[i]->flush();
+		}
+	}
+}
+
+/*
+ * At exit: stop the writer, and write out the logs that were never closed.
+ */
+static void stopWriter() {
+	{
+		lock_guard<mutex> l(writerLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (writer.joinable()) {
+		writer.join();
+	}
+	for (unsigned i = 0; i < openLogs.size(); i++) {
+		openLogs[i]->flush();
+	}
+}
+
+static void addLog(GenerationLog *log) {
+	lock_guard<mutex> l(writerLock);
+	if (!writer.joinable() && !stopping) {
+		atexit(stopWriter);
+		writer = thread(writeLogs);
+	}
+	openLogs.push_back(log);
+}
+
+static void removeLog(GenerationLog *log) {
+	lock_guard<mutex> l(writerLock);
+	openLogs.erase(remove(openLogs.begin(), openLogs.end(), log), openLogs.end());
+}
+
+/*
+ * A line of the text log.
+ */
+static int formatLine(char *line, size_t size, long generation, const GenerationResult &result, uint64_t trainCases, uint64_t testCases) {
+	int n = snprintf(line, size, "%ld\t%g\t%g\t%g\t%g\t%g\t%g\n", generation,
+		1.0 / (1.0 + result.trainPerf), 1.0 / (1.0 + result.testPerf),
+		(double) result.trainHits / (double) trainCases, (double) result.testHits / (double) testCases,
+		result.trainPerf, result.testPerf);
+	return min(n, (int) size - 1);
+}
+
+//
+// GenerationLog
+//
+
+/*
+ * The length of the first keep records of an existing log (or of all its
+ * whole records, if it has fewer: keep is set to the number kept), or -1 if
+ * it isn't a log in the format asked for.
+ */
+static off_t keptLength(int fd, bool binary, long &keep) {
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		return -1;
+	}
+	vector<char> contents(st.st_size);
+	if (pread(fd, contents.data(), contents.size(), 0) != (ssize_t) contents.size()) {
+		return -1;
+	}
+
+	if (binary) {
+		BinaryLogHeader header;
+		if (contents.size() < sizeof(header)) {
+			return -1;
+		}
+		memcpy(&header, contents.data(), sizeof(header));
+		if (memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != BINARY_LOG_VERSION
+				|| header.recordBytes != sizeof(BinaryLogRecord)) {
+			return -1;
+		}
+		keep = min(keep, (long) ((contents.size() - sizeof(header)) / sizeof(BinaryLogRecord)));
+		return sizeof(header) + (off_t) keep * sizeof(BinaryLogRecord);
+	}
+
+	if (contents.size() >= 8 && memcmp(contents.data(), BINARY_LOG_MAGIC, 8) == 0) {
+		return -1;
+	}
+	off_t length = 0;
+	for (long line = 0; line < keep; line++) {
+		char *eol = (char*) memchr(contents.data() + length, '\n', contents.size() - length);
+		if (eol == 0) {
+			keep = line;
+			break;
+		}
+		length = eol - contents.data() + 1;
+	}
+	return length;
+}
+
+GenerationLog::GenerationLog(const std::string &filename, long keep) {
+
+	binary = binary_log;
+	trainCases = numTrainingCases();
+	testCases = test_targets.size();
+	ring.resize(LOG_BUFFER_BYTES);
+	out.reserve(LOG_BUFFER_BYTES);
+	start = 0;
+	used = 0;
+
+	if (keep > 0) {
+		// a log that is short of the checkpoint (say its last records were
+		// lost) is kept as it is, rather than losing the lot
+		long kept = keep;
+		fd = ::open(filename.c_str(), O_RDWR);
+		off_t length = (fd < 0) ? -1 : keptLength(fd, binary, kept);
+		if (length >= 0 && ftruncate(fd, length) == 0 && lseek(fd, length, SEEK_SET) == length) {
+			if (kept < keep) {
+				cerr << "Results file " << filename << " has only " << kept << " of the " << keep << " generations up to the checkpoint" << endl;
+			}
+			addLog(this);
+			return;
+		}
+		cerr << "Results file " << filename << " isn't a results log of this format, so it is started again" << endl;
+		if (fd >= 0) {
+			::close(fd);
+		}
+	}
+
+	fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		cerr << "Could not open results file " << filename << endl;
+		return;
+	}
+	if (binary) {
+		BinaryLogHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic));
+		header.version = BINARY_LOG_VERSION;
+		header.recordBytes = sizeof(BinaryLogRecord);
+		header.trainCases = trainCases;
+		header.testCases = testCases;
+		append((const char*) &header, sizeof(header));
+	}
+	addLog(this);
+}
+
+GenerationLog::~GenerationLog() {
+	close();
+}
+
+void GenerationLog::write(long generation, const GenerationResult &result) {
+
+	if (fd < 0) {
+		return;
+	}
+	if (binary) {
+		BinaryLogRecord r;
+		memset(&r, 0, sizeof(r));
+		r.generation = generation;
+		r.trainPerf = result.trainPerf;
+		r.testPerf = result.testPerf;
+		r.trainHits = result.trainHits;
+		r.testHits = result.testHits;
+		append((const char*) &r, sizeof(r));
+		return;
+	}
+	char line[256];
+	int n = formatLine(line, sizeof(line), generation, result, trainCases, testCases);
+	append(line, n);
+}
+
+void GenerationLog::append(const char *data, size_t n) {
+
+	unique_lock<mutex> l(lock);
+	if (ring.size() - used < n) {
+		// full: write it out here and now
+		l.unlock();
+		flush();
+		l.lock();
+	}
+	size_t end = (start + used) % ring.size();
+	size_t first = min(n, ring.size() - end);
+	memcpy(&ring[end], data, first);
+	memcpy(&ring[0], data + first, n - first);
+	used += n;
+	if (used > ring.size() / 2) {
+		wake.notify_one();
+	}
+}
+
+void GenerationLog::flush() {
+
+	lock_guard<mutex> w(writeLock);
+	if (fd < 0) {
+		return;
+	}
+	{
+		lock_guard<mutex> l(lock);
+		out.resize(used);
+		size_t first = min(used, ring.size() - start);
+		memcpy(out.data(), &ring[start], first);
+		memcpy(out.data() + first, &ring[0], used - first);
+		start = (start + used) % ring.size();
+		used = 0;
+	}
+
+	size_t done = 0;
+	while (done < out.size()) {
+		ssize_t k = ::write(fd, out.data() + done, out.size() - done);
+		if (k < 0 && errno == EINTR) {
+			continue;
+		}
+		if (k <= 0) {
+			break;
+		}
+		done += k;
+	}
+}
+
+void GenerationLog::close() {
+	if (fd < 0) {
+		return;
+	}
+	removeLog(this);
+	flush();
+	lock_guard<mutex> w(writeLock);
+	::close(fd);
+	fd = -1;
+}
+
+bool printBinaryLog(const std::string &filename, std::ostream &os) {
+
+	ifstream in(filename.c_str(), ios::binary);
+	BinaryLogHeader header;
+	if (!in.read((char*) &header, sizeof(header)) || memcmp(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != BINARY_LOG_VERSION || header.recordBytes < sizeof(BinaryLogRecord)) {
+		return false;
+	}
+
+	vector<char> record(header.recordBytes);
+	while (in.read(record.data(), record.size())) {
+		BinaryLogRecord r;
+		memcpy(&r, record.data(), sizeof(r));
+		GenerationResult result;
+		result.trainPerf = r.trainPerf;
+		result.testPerf = r.testPerf;
+		result.trainHits = r.trainHits;
+		result.testHits = r.testHits;
+		char line[256];
+		int n = formatLine(line, sizeof(line), r.generation, result, header.trainCases, header.testCases);
+		os.write(line, n);
+	}
+	return true;
+}
@@ -0,0 +1,126 @@
+/**
+ * GenerationLog class.
+ *
+ * The results file of a run (or island): one record per generation. Records
+ * are formatted by the thread that logs them into a ring buffer, and written
+ * to the file by a background thread (one for all the logs of the process),
+ * so logging never waits for the disk. Whatever has been logged is written
+ * when the log is closed and when the process exits (a run stopped by SIGINT
+ * or SIGTERM exits in an orderly way, see catchStopSignals()).
+ *
+ * Logs are text by default, a line of tab-separated columns per generation
+ * (see write()). With --log-format binary they are a
+ * BinaryLogHeader followed by one BinaryLogRecord per generation (all
+ * little-endian), which "gpsr printlog" turns back into text.
+ */
+
+#ifndef GENLOG_H
+#define GENLOG_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include <stdint.h>
+
+#include "evolve.h"
+
+/* the buffer of each log */
+#define LOG_BUFFER_BYTES (64 * 1024)
+/* how often the background thread writes out the logs */
+#define LOG_FLUSH_INTERVAL_MS 100
+
+#define BINARY_LOG_MAGIC "GPSRLOG1"
+#define BINARY_LOG_VERSION 1
+
+/**
+ * The start of a binary log.
+ */
+struct BinaryLogHeader {
+	char magic[8];		// BINARY_LOG_MAGIC
+	uint32_t version;	// BINARY_LOG_VERSION
+	uint32_t recordBytes;	// sizeof(BinaryLogRecord)
+	uint64_t trainCases;	// for the hit rates
+	uint64_t testCases;
+};
+
+/**
+ * One generation of a binary log.
+ */
+struct BinaryLogRecord {
+	int64_t generation;
+	double trainPerf;	// training MSE
+	double testPerf;	// testing MSE
+	int32_t trainHits;
+	int32_t testHits;
+};
+
+class GenerationLog {
+
+	public:
+		/**
+		 * Constructor. Opens (truncates) the log, in the format asked for
+		 * with --log-format.
+		 * @param filename the file
+		 * @param keep the number of records of the existing log to keep
+		 * (when resuming a run: the generations up to its checkpoint)
+		 */
+		explicit GenerationLog(const std::string &filename, long keep = 0);
+
+		/**
+		 * Destructor. Closes the log.
+		 */
+		~GenerationLog();
+
+		/**
+		 * Log a generation: generation, training and testing scores
+		 * (1 / (1 + MSE)), training and testing hit rates, training and
+		 * testing MSE.
+		 * @param generation the generation (or, for steady state, the
+		 * number of evaluations)
+		 * @param result the performance of the best individual
+		 */
+		void write(long generation, const GenerationResult &result);
+
+		/**
+		 * Write out everything logged so far and close the file.
+		 */
+		void close();
+
+		/**
+		 * Write out everything logged so far (done by the background
+		 * thread, or by the logging thread when the buffer is full).
+		 */
+		void flush();
+
+	private:
+		GenerationLog(const GenerationLog &);	// not copyable
+		void operator=(const GenerationLog &);
+
+		void append(const char *data, size_t n);
+
+		int fd;
+		bool binary;
+		uint64_t trainCases;
+		uint64_t testCases;
+
+		// the ring buffer
+		std::vector<char> ring;
+		size_t start;		// the oldest byte not yet written
+		size_t used;
+		std::mutex lock;
+
+		// held while writing to the file, so writes stay in order
+		std::mutex writeLock;
+		std::vector<char> out;
+};
+
+/**
+ * Print a binary log as text (as the text log would have been).
+ * @param filename the binary log
+ * @param os where to print it
+ * @return false if the file is not a binary log
+ */
+bool printBinaryLog(const std::string &filename, std::ostream &os);
+
+#endif
@@ -2,47 +2,82 @@
 #include "gpnode.h"
 #include "rng.h"
 
-std::vector<ResultType> valueStack;
+thread_local std::vector<ResultType> valueStack;
 
-std::vector<ResultType> variables;
-ResultType targets;
+std::vector<DataColumn> variables;
+DataColumn targets;
 std::vector<double> constants;
 
-std::vector<ResultType> test_variables;
-ResultType test_targets;
+std::vector<DataColumn> test_variables;
+DataColumn test_targets;
 
 std::vector<GPNode> t_unaries;
 std::vector<GPNode> t_binaries;
 std::vector<GPNode> t_variables;
 std::vector<GPNode> t_constants;
 
+RunConfig::RunConfig() {
+	tournamentSize = 3;
+	crossover_prob = 0.7;
+	mutation_prob = 0.02;
+	genomeSize = 256;
+	popsize = 500;
+	numgens = 100;
+	no_same_mates = false;
+	linear_scaling = false;
+	use_potency = false;
+	potency_increasing = false;
+	hitsCriterion = 0.01;
+}
+
+RunConfig baseConfig;
+thread_local const RunConfig *config = &baseConfig;
+
 // default settings that can be set via command line args
-int tournamentSize = 3;
-double crossover_prob = 0.7;
-double mutation_prob = 0.02;
-int genomeSize = 256;
-int popsize = 500;
-int numgens = 100;
-int currentgen = 0;
+thread_local int currentgen = 0;
 int numConstants = 20;
 int numVariables = 1;
 double constRange = 10.0;
-bool no_same_mates = false;
-bool linear_scaling = false;
 bool loose_metric = false;
-bool use_potency = false;
-bool potency_increasing = false;
 bool seed_specified = false;
-double hitsCriterion = 0.01;
 bool train_with_noise = false;
 double jitterFactor = 0.01;
 int jitterAmount = 2;
+int numThreads = 1;
+int shardSize = 0;
+bool parallel_breeding = false;
+int numIslands = 1;
+int migrationInterval = 10;
+int migrationRate = 2;
+std::string migration_topology = "ring";
+std::string migration_listen = "";
+std::vector<std::string> migration_destinations;
+std::vector<std::string> farm_workers;
+int localWorkers = 0;
+bool steady_state = false;
+int numRuns = 1;
+std::string sweep_spec = "";
+std::string sweep_file = "";
+long logInterval = 0;
+long streamChunk = 0;
+bool shared_data = false;
+bool binary_log = false;
+int checkpointInterval = 10;
 
 std::string unaries = "lsc2";
 std::string best_file = "best";
 std::string logfile = "res";
+std::string utilisation_file = "";
+std::string timing_file = "";
+std::string perf_file = "";
+std::string trace_file = "";
+std::string checkpoint_file = "";
+std::string resume_file = "";
+std::vector<std::string> seed_files;
 std::string training_file = "train.dat";
 std::string testing_file = "test.dat";
 
-RNG rng(1);
+std::atomic<int> stopSignal(0);
+
+thread_local RNG rng(1);
 ulong seed;
@@ -8,9 +8,11 @@
 #include <valarray>
 #include <stack>
 #include <string>
+#include <atomic>
 
 #include "rng.h"
 #include "gpnode.h"
+#include "datacolumn.h"
 
 /********
  *
@@ -25,21 +27,26 @@
 #define BRANCHSIZE 10 
 #define NSM_MAX_TRIES 10000
 
+/* splitting of fitness evaluation into stealable chunks */
+#define EVAL_CHUNKS_PER_THREAD 4	// an individual costing more than 1/(4 x threads) of the population is split
+#define EVAL_CHUNK_MIN_CASES 1024	// never split into chunks smaller than this
+
 
 // create a type for the variables (could be 2d)
 typedef std::valarray<double> ResultType;
 
-extern std::vector<ResultType> valueStack;
+// evaluation stack (one per thread, so individuals can be evaluated in parallel)
+extern thread_local std::vector<ResultType> valueStack;
 
-// now define the variables
-extern std::vector<ResultType> variables;
+// now define the variables (columns may be mapped straight from a binary dataset)
+extern std::vector<DataColumn> variables;
 
 // targets
-extern ResultType targets;
+extern DataColumn targets;
 
 // testing stuff
-extern std::vector<ResultType> test_variables;
-extern ResultType test_targets;
+extern std::vector<DataColumn> test_variables;
+extern DataColumn test_targets;
 
 extern std::vector<double> constants;
 
@@ -48,35 +55,85 @@ extern std::vector<GPNode> t_binaries;
 extern std::vector<GPNode> t_variables;
 extern std::vector<GPNode> t_constants;
 
+/**
+ * The settings of a run of GP (as opposed to the data, which all runs in a
+ * process share, and the way the work is carried out).
+ */
+struct RunConfig {
+	int tournamentSize;
+	double crossover_prob;
+	double mutation_prob;
+	int genomeSize;
+	int popsize;
+	int numgens;
+	bool no_same_mates;
+	bool linear_scaling;
+	bool use_potency;
+	bool potency_increasing;
+	double hitsCriterion;
+
+	/**
+	 * Constructor. The default settings.
+	 */
+	RunConfig();
+};
+
+// the settings given on the command line
+extern RunConfig baseConfig;
+// the settings of the run this thread is working on (normally baseConfig;
+// see runSweep for runs with other settings)
+extern thread_local const RunConfig *config;
+
 // run settings
-extern int tournamentSize;
-extern double crossover_prob;
-extern double mutation_prob;
-extern int genomeSize;
-extern int popsize;
-extern int numgens;
-extern int currentgen;
+// the generation being evolved (one per thread, since islands evolve side by side)
+extern thread_local int currentgen;
 extern int numConstants;
 extern int numVariables;
 extern double constRange;
-extern bool no_same_mates;
-extern bool linear_scaling;
 extern bool loose_metric;
-extern bool use_potency;
-extern bool potency_increasing;
 extern bool seed_specified;
-extern double hitsCriterion;
 extern bool train_with_noise;
 extern double jitterFactor;
 extern int jitterAmount;
+extern int numThreads;
+extern int shardSize;
+extern bool parallel_breeding;
+extern int numIslands;
+extern int migrationInterval;
+extern int migrationRate;
+extern std::string migration_topology;
+extern std::string migration_listen;
+extern std::vector<std::string> migration_destinations;
+extern std::vector<std::string> farm_workers;
+extern int localWorkers;
+extern bool steady_state;
+extern int numRuns;
+extern std::string sweep_spec;
+extern std::string sweep_file;
+extern long logInterval;
+extern long streamChunk;
+extern bool shared_data;
+extern bool binary_log;
+extern int checkpointInterval;
 
 extern std::string unaries;
 extern std::string training_file;
 extern std::string testing_file;
 extern std::string best_file;
 extern std::string logfile;
+extern std::string utilisation_file;
+extern std::string timing_file;
+extern std::string perf_file;
+extern std::string trace_file;
+extern std::string checkpoint_file;
+extern std::string resume_file;
+extern std::vector<std::string> seed_files;
 
 extern ulong seed;
-extern RNG rng;
+// the signal (SIGINT or SIGTERM) the run was asked to stop by, or 0: the
+// runs stop at the end of the generation (see catchStopSignals)
+extern std::atomic<int> stopSignal;
+// the random number generator (one per thread, see parallelBreed)
+extern thread_local RNG rng;
 
 #endif
@@ -3,19 +3,68 @@
 #include "rng.h"
 #include "usefulfunctions.h"
 #include "global.h"
+#include "threadpool.h"
 
 using namespace std;
 
+void selectSlot(GPPopulation &pop, GPPopulation &selected, int i) {
+	GPProgram* luckyBugger = pop.getIndividual(select(pop));
+	selected.setIndividual(i, luckyBugger);
+}
+
+void crossoverSlot(GPPopulation &pop, GPPopulation &children, int i) {
+
+	GPProgram *child;
+	GPProgram *mom;
+	GPProgram *dad;
+
+	int popsize = pop.getSize();
+	if (rng.flip(config->crossover_prob)) {
+		mom = pop.getIndividual(intRandom(0, popsize - 1));
+
+		if (config->no_same_mates) {
+			// never pick a mate with the same fitness
+			int numTries = 0;
+			do {
+				dad = pop.getIndividual(intRandom(0, popsize - 1));
+				numTries++;
+			} while(dad->getFitness()==mom->getFitness() && numTries < NSM_MAX_TRIES);
+		}
+		else {
+			dad = pop.getIndividual(intRandom(0, popsize - 1));
+		}
+		child = xover(*mom, *dad);
+		children.setIndividual(i, child);
+		delete child;
+	}
+}
+
+void mutateSlot(GPPopulation &pop, GPPopulation &mutants, int i) {
+
+	GPProgram *mutant;
+
+	if (rng.flip(config->mutation_prob)) {
+		// do a mutation, but first choose whether to do a node
+		// or a branch mutation
+		mutant = pop.getIndividual(i);
+		if (rng.flip(0.5)) {
+			// do a node mutation
+			nodeMutate(*mutant);
+		}
+		else {
+			// do a branch mutation
+			branchMutate(*mutant);
+		}
+		mutants.setIndividual(i, mutant);
+	}
+}
+
 void tournamentSelection(GPPopulation &pop) {
 
 	GPPopulation *temp = new GPPopulation(pop);
 
-	int selected_index = 0;
-	GPProgram* luckyBugger;
 	for (int i = 0; i < temp->getSize(); i++) {
-		selected_index = select(pop);
-		luckyBugger = pop.getIndividual(selected_index);
-		temp->setIndividual(i, luckyBugger);
+		selectSlot(pop, *temp, i);
 	}
 
 	pop = *temp;
@@ -25,23 +74,9 @@ void tournamentSelection(GPPopulation &pop) {
 void mutation(GPPopulation &pop) {
 
 	GPPopulation *temp = new GPPopulation(pop);
-	GPProgram *mutant;
 
 	for (int i = 0; i < pop.getSize(); i++) {
-		if (rng.flip(mutation_prob)) {
-			// do a mutation, but first choose whether to do a node
-			// or a branch mutation
-			mutant = pop.getIndividual(i);
-			if (rng.flip(0.5)) {
-				// do a node mutation
-				nodeMutate(*mutant);
-			}
-			else {
-				// do a branch mutation
-				branchMutate(*mutant);
-			}
-			temp->setIndividual(i, mutant);
-		}
+		mutateSlot(pop, *temp, i);
 	}
 	pop = *temp;
 	delete temp;
@@ -50,35 +85,43 @@ void mutation(GPPopulation &pop) {
 void crossover(GPPopulation &pop) {
 
 	GPPopulation *temp = new GPPopulation(pop);
-        GPProgram *child;
-        GPProgram *mom;
-        GPProgram *dad;
-
-        int popsize = pop.getSize();
-        for (int i = 0; i < popsize; i++) {
-            if (rng.flip(crossover_prob)) {
-                mom = pop.getIndividual(intRandom(0, popsize - 1));
-				
-				if (no_same_mates) {
-					// never pick a mate with the same fitness
-					int numTries = 0;
-					do {
-                				dad = pop.getIndividual(intRandom(0, popsize - 1));
-						numTries++;
-					} while(dad->getFitness()==mom->getFitness() && numTries < NSM_MAX_TRIES);
-				}
-				else {
-                	dad = pop.getIndividual(intRandom(0, popsize - 1));
-				}
-                //child = new GPProgram(*(xover(mom, dad)));
-                child = xover(*mom, *dad);
-                temp->setIndividual(i, child);
-            }
-        }
+
+	for (int i = 0; i < pop.getSize(); i++) {
+		crossoverSlot(pop, *temp, i);
+	}
 	pop = *temp;
 	delete temp;
 }
 
+void parallelBreed(GPPopulation &pop, ulong streamSeed, int generation) {
+
+	int size = pop.getSize();
+
+	// one random stream per offspring slot, carried through all three phases
+	vector<RNG> streams(size);
+	for (int i = 0; i < size; i++) {
+		streams[i].reseed(RNG::streamSeed(streamSeed, generation, i));
+	}
+
+	// run a phase over every slot on the worker pool, with the slot's stream
+	// standing in for the (thread-local) rng of whichever thread picks it up
+	typedef void (*SlotOperator)(GPPopulation &, GPPopulation &, int);
+	SlotOperator phases[3] = { selectSlot, crossoverSlot, mutateSlot };
+
+	for (int p = 0; p < 3; p++) {
+		GPPopulation *temp = new GPPopulation(pop);
+		workerPool().run(size, [&](int i) {
+			RNG saved = rng;
+			rng = streams[i];
+			phases[p](pop, *temp, i);
+			streams[i] = rng;
+			rng = saved;
+		});
+		pop = *temp;
+		delete temp;
+	}
+}
+
 int select(GPPopulation &pop) {
 	int best_index = intRandom(0, pop.getSize() - 1);
         int competitor_index = 0;
@@ -89,7 +132,7 @@ int select(GPPopulation &pop) {
         double best_perf = best->getFitness();
         double competitor_perf = 0;
 
-        for (int i = 1; i < tournamentSize; i++) {
+        for (int i = 1; i < config->tournamentSize; i++) {
 
             competitor_index =intRandom(0, pop.getSize() - 1);
             competitor = pop.getIndividual(competitor_index);
@@ -28,6 +28,45 @@ void mutation(GPPopulation &pop);
 void crossover(GPPopulation &pop); 
 
 
+/**
+ * Breed the next generation in parallel. Selection, crossover and mutation are
+ * carried out as in the serial operators, but each offspring slot draws its 
+ * random numbers from its own stream, derived from (seed, generation, slot), 
+ * so the result is the same whatever the number of threads.
+ * @param pop the population
+ * @param streamSeed the seed the streams are derived from (the run's seed)
+ * @param generation the generation being bred
+ */
+void parallelBreed(GPPopulation &pop, ulong streamSeed, int generation);
+
+/**
+ * Selection for one slot: run a tournament on pop and copy the winner into 
+ * slot i of selected.
+ * @param pop the population to select from
+ * @param selected the population being filled
+ * @param i the slot
+ */
+void selectSlot(GPPopulation &pop, GPPopulation &selected, int i);
+
+/**
+ * Crossover for one slot: with the crossover probability, breed a child from
+ * two random members of pop and place it into slot i of children.
+ * @param pop the parents
+ * @param children the population being filled
+ * @param i the slot
+ */
+void crossoverSlot(GPPopulation &pop, GPPopulation &children, int i);
+
+/**
+ * Mutation for one slot: with the mutation probability, node- or 
+ * branch-mutate the individual in slot i of pop and place it into slot i 
+ * of mutants.
+ * @param pop the population
+ * @param mutants the population being filled
+ * @param i the slot
+ */
+void mutateSlot(GPPopulation &pop, GPPopulation &mutants, int i);
+
 /**
  * Tournament selection. Performs an n-way tournament on randomly selected competitors and returns the index of the winner.
  * @param pop the population
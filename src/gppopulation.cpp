@@ -1,6 +1,13 @@
 #include <iostream>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
 #include "gppopulation.h"
 #include "usefulfunctions.h"
+#include "threadpool.h"
+#include "evalfarm.h"
+#include "streaming.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -103,6 +110,12 @@ void GPPopulation::setIndividual(int index, GPProgram* indy) {
 	population[index] = new GPProgram(*indy);
 }
 
+GPProgram* GPPopulation::swapIndividual(int index, GPProgram* indy) {
+	GPProgram *ret = population[index];
+	population[index] = indy;
+	return ret;
+}
+
 GPProgram* GPPopulation::getBestIndividual() {
 
 	GPProgram *ret; 
@@ -170,17 +183,115 @@ int GPPopulation::getIndexOfWorst() {
 	return index;
 }
 
+vector<int> GPPopulation::getRanking() const {
+	vector<int> order(population.size());
+	for (unsigned i = 0; i < population.size(); i++) {
+		order[i] = i;
+	}
+	stable_sort(order.begin(), order.end(), [this](int a, int b) {
+		return population[a]->getFitness() < population[b]->getFitness();
+	});
+	return order;
+}
+
 void GPPopulation::calculatePopulationFitness() {
 
-	GPProgram *gpr;
+	// make the potency decisions up front (in population order, as a serial
+	// run would) so that the workers never touch the global rng
+	vector<char> applyScaling(population.size(), 1);
+	if (config->linear_scaling && config->use_potency) {
+		for (unsigned i = 0; i < population.size(); i++) {
+			applyScaling[i] = potencyFlip();
+		}
+	}
+
+	// farmed out to worker processes
+	if (evaluationFarm() != 0) {
+		evaluationFarm()->evaluate(population, applyScaling);
+		updateBestIndividual();
+		return;
+	}
 
+	// the training data is read a chunk at a time
+	if (trainingStream() != 0) {
+		streamPopulationFitness(population, applyScaling);
+		updateBestIndividual();
+		return;
+	}
+
+	// data-parallel mode: the threads share out the fitness cases of each
+	// individual in turn instead
+	if (shardSize > 0) {
+		for (unsigned i = 0; i < population.size(); i++) {
+			population[i]->calcFitness(true, applyScaling[i]);
+		}
+		updateBestIndividual();
+		return;
+	}
+
+	// One task per individual, costed at (nodes x cases). Individuals that
+	// cost much more than a fair share of the work are split into chunks of
+	// fitness cases so that idle threads can steal them; the fitness of a
+	// split individual is worked out by whichever chunk finishes last.
+	int ncases = targets.size();
+	int nthreads = workerPool().getNumThreads();
+
+	double totalCost = 0.0;
+	for (unsigned i = 0; i < population.size(); i++) {
+		totalCost += (double) population[i]->getSize() * ncases;
+	}
+	double chunkCost = totalCost / (nthreads * EVAL_CHUNKS_PER_THREAD);
+
+	struct EvalTask {
+		int indy;
+		int begin;
+		int end;
+	};
+	vector<EvalTask> tasks;
+	vector<double> costs;
+	tasks.reserve(population.size());
+	costs.reserve(population.size());
+
+	vector<int> numChunks(population.size(), 1);
+	for (unsigned i = 0; i < population.size(); i++) {
+		double cost = (double) population[i]->getSize() * ncases;
+		if (nthreads > 1 && cost > chunkCost) {
+			numChunks[i] = min((int) ceil(cost / chunkCost), ncases / EVAL_CHUNK_MIN_CASES);
+			if (numChunks[i] < 1) {
+				numChunks[i] = 1;
+			}
+		}
+		for (int c = 0; c < numChunks[i]; c++) {
+			EvalTask t = { (int) i, (int) ((long) ncases * c / numChunks[i]), (int) ((long) ncases * (c + 1) / numChunks[i]) };
+			tasks.push_back(t);
+			costs.push_back((double) population[i]->getSize() * (t.end - t.begin));
+		}
+	}
+
+	vector<ResultType> guesses(population.size());
+	vector<atomic<int> > chunksLeft(population.size());
 	for (unsigned i = 0; i < population.size(); i++) {
-		gpr = population[i];
-		gpr->calcFitness(true);
-		//cout << "gpr is:\n" << *gpr << endl;
+		if (numChunks[i] > 1) {
+			guesses[i].resize(ncases);
+		}
+		chunksLeft[i] = numChunks[i];
 	}
+
+	workerPool().run(costs, [&](int k) {
+		const EvalTask &t = tasks[k];
+		TRACE_SPAN("evaluate", t.indy);
+		GPProgram *gpr = population[t.indy];
+		if (numChunks[t.indy] == 1) {
+			gpr->calcFitness(true, applyScaling[t.indy]);
+			return;
+		}
+		guesses[t.indy][slice(t.begin, t.end - t.begin, 1)] = gpr->evaluate(true, t.begin, t.end);
+		if (chunksLeft[t.indy].fetch_sub(1) == 1) {
+			gpr->calcFitness(true, applyScaling[t.indy], guesses[t.indy]);
+		}
+	});
+
 	updateBestIndividual();
-	//delete gpr;
 }
 
 ostream& operator<<(ostream& os, const GPPopulation &pop) {
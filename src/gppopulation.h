@@ -112,6 +112,21 @@ class GPPopulation {
 		 */
 		int getIndexOfWorst();
 		
+		/**
+		 * Get the population indexes ordered by fitness, best first (used 
+		 * for picking migrants and the individuals they replace)
+		 * @return the indexes, best first
+		 */
+		std::vector<int> getRanking() const;
+
+		/**
+		 * Put an individual (itself, not a copy) into a slot.
+		 * @param index the slot
+		 * @param indy the individual, now owned by the population
+		 * @return the individual that was in the slot (the caller deletes it)
+		 */
+		GPProgram* swapIndividual(int index, GPProgram* indy);
+
 		/**
 		 * Calculate the fitness of the population
 		 */
@@ -6,6 +6,10 @@
 #include "gpoperators.h"
 #include "rng.h"
 #include "usefulfunctions.h"
+#include "threadpool.h"
+#include "streaming.h"
+#include "timing.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -376,13 +380,19 @@ bool GPProgram::sanityCheck() {
 }
 
 ResultType GPProgram::evaluate(bool training) {
+	return evaluate(training, 0, (training) ? targets.size() : test_targets.size());
+}
+
+ResultType GPProgram::evaluate(bool training, int begin, int end) {
 
 	clearStack();	
 
 	GPNode *current;
 	string type;
 
-	int arraysize = (training) ? targets.size() : test_targets.size();
+	int arraysize = end - begin;
+	slice cases(begin, arraysize, 1);
+	COUNT_EVALUATION(genome.size(), arraysize);
 
 	ResultType ret(arraysize);
 	ResultType doubleData(arraysize);
@@ -469,7 +479,7 @@ ResultType GPProgram::evaluate(bool training) {
 			valueStack.push_back(protectedLog(op1));
 		}
 		else if (type == "VAR") {
-			op1=(training ? variables[current->getData()] : test_variables[current->getData()]);
+			op1=(training ? variables[current->getData()][cases] : test_variables[current->getData()][cases]);
 			valueStack.push_back(op1);
 		}
 		//else if (type == "SQRT") {
@@ -493,48 +503,65 @@ ResultType GPProgram::evaluate(bool training) {
 
 double GPProgram::calcFitness(bool training) {
 
-	double ret = 0.0;
+	bool applyScaling = true;
+	if (training && config->linear_scaling && config->use_potency) {
+		applyScaling = potencyFlip();
+	}
+	return calcFitness(training, applyScaling);
+}
 
-	int arraysize = (training) ? targets.size() : test_targets.size();
 
-	ResultType res(arraysize);
+double GPProgram::calcFitness(bool training, bool applyScaling) {
 
-	if (linear_scaling) {
+	if (shardSize > 0) {
+		double sse = 0.0;
+		int hits = 0;
+		evaluateShards(training, applyScaling, config->hitsCriterion, sse, hits);
 
+		int arraysize = (training) ? targets.size() : test_targets.size();
+		double ret = sse / (double) arraysize;
+
+		// only update fitness during training
 		if (training) {
-			// only do this during training to calculate the coefficients
-			if (use_potency) {
+			this->fitness = ret;
+		}
+		if (isnan(ret) || isinf(ret)) {
+			ret = 1e19;
+		}
+		return ret;
+	}
+
+	return calcFitness(training, applyScaling, evaluate(training));
+}
 
-				// Apply LS at smaller amounts at the start of the run and 
-				// increase as the run progresses
-				double run_progress = ( ((double) currentgen) / ((double) numgens) );
 
-				// or, apply more LS at the start and less at the end
-				if (!potency_increasing) {
-						run_progress = 1.0 - run_progress;
-				}
+double GPProgram::calcFitness(bool training, bool applyScaling, const ResultType &guesses) {
 
-				if (rng.flip(run_progress)) {
-					linearScaling(evaluate(true), targets);
-				}
-			}
-			else {
-				linearScaling(evaluate(true), targets);
-			}
+	double ret = 0.0;
+
+	int arraysize = (training) ? targets.size() : test_targets.size();
+
+	ResultType res(arraysize);
+
+	if (config->linear_scaling) {
+
+		if (training && applyScaling) {
+			// only do this during training to calculate the coefficients
+			linearScaling(guesses, targets);
 		}
 
 		ResultType lsA(arraysize);
 		createResultType(lsCoeffA, lsA);
 		ResultType lsB(arraysize);
 		createResultType(lsCoeffB, lsB);
-		lsB *= evaluate(training);
+		lsB *= guesses;
 		lsA += lsB;
 		res = (training) ? lsA - targets : lsA - test_targets;
 		res *= res;
 
 	}
 	else {
-		res = (training) ? evaluate(true) - targets : evaluate(false) - test_targets;
+		res = (training) ? guesses - targets : guesses - test_targets;
 		res *= res;
 	}
 
@@ -553,7 +580,7 @@ double GPProgram::calcFitness(bool training) {
 }
 
 
-void GPProgram::linearScaling(const ResultType &evolved, const ResultType &target) {
+void GPProgram::linearScaling(const ResultType &evolved, const DataColumn &target) {
 
 	int count = evolved.size();
 	double meanTarget = 0.0;
@@ -593,6 +620,112 @@ void GPProgram::linearScaling(const ResultType &evolved, const ResultType &targe
 }
 
 
+/*
+ * Moments of the guesses (e) and targets (t) over a shard of the fitness 
+ * cases. Shards are merged pairwise (Chan et al.) in shard order, so the 
+ * result does not depend on how the shards were spread over the threads.
+ */
+struct ShardMoments {
+	double n;
+	double meanE;
+	double meanT;
+	double m2E;	// sum of (e - meanE)^2
+	double cET;	// sum of (e - meanE) * (t - meanT)
+};
+
+static ShardMoments shardMoments(const ResultType &evolved, const DataColumn &target, int begin) {
+
+	ShardMoments ret = { (double) evolved.size(), 0.0, 0.0, 0.0, 0.0 };
+	for (unsigned i = 0; i < evolved.size(); i++) {
+		ret.meanE += evolved[i];
+		ret.meanT += target[begin + i];
+	}
+	ret.meanE /= ret.n;
+	ret.meanT /= ret.n;
+
+	for (unsigned i = 0; i < evolved.size(); i++) {
+		double factor = (evolved[i] - ret.meanE);
+		ret.cET += (target[begin + i] - ret.meanT) * factor;
+		ret.m2E += factor * factor;
+	}
+	return ret;
+}
+
+static ShardMoments mergeMoments(const ShardMoments &a, const ShardMoments &b) {
+
+	ShardMoments ret;
+	double dE = b.meanE - a.meanE;
+	double dT = b.meanT - a.meanT;
+	ret.n = a.n + b.n;
+	ret.meanE = a.meanE + dE * b.n / ret.n;
+	ret.meanT = a.meanT + dT * b.n / ret.n;
+	ret.m2E = a.m2E + b.m2E + dE * dE * a.n * b.n / ret.n;
+	ret.cET = a.cET + b.cET + dE * dT * a.n * b.n / ret.n;
+	return ret;
+}
+
+void GPProgram::evaluateShards(bool training, bool applyScaling, double criterion, double &sse, int &hits) {
+
+	const DataColumn &target = (training) ? targets : test_targets;
+	int ncases = target.size();
+	int numShards = (ncases + shardSize - 1) / shardSize;
+	bool scale = config->linear_scaling && training && applyScaling;
+
+	// pass 1: evaluate each shard (and its moments, if we need new LS coefficients)
+	vector<ResultType> guesses(numShards);
+	vector<ShardMoments> moments(numShards);
+	workerPool().run(numShards, [&](int s) {
+		TRACE_SPAN("evaluate shard", s);
+		int begin = s * shardSize;
+		guesses[s] = evaluate(training, begin, min(begin + shardSize, ncases));
+		if (scale) {
+			moments[s] = shardMoments(guesses[s], target, begin);
+		}
+	});
+
+	if (scale) {
+		ShardMoments total = moments[0];
+		for (int s = 1; s < numShards; s++) {
+			total = mergeMoments(total, moments[s]);
+		}
+
+		double b = 1.0;
+		if (total.m2E != 0.0) {
+			b = total.cET / total.m2E;
+		}
+		else if (total.meanE == 0.0) {
+			b = 1.0;
+		}
+		else {
+			b = total.meanT / total.meanE;
+		}
+		this->lsCoeffA = total.meanT - (b * total.meanE);
+		this->lsCoeffB = b;
+	}
+
+	// pass 2: squared error and hits of the (scaled) guesses
+	vector<double> shardSse(numShards, 0.0);
+	vector<int> shardHits(numShards, 0);
+	workerPool().run(numShards, [&](int s) {
+		int begin = s * shardSize;
+		for (unsigned i = 0; i < guesses[s].size(); i++) {
+			double err = (lsCoeffA + lsCoeffB * guesses[s][i]) - target[begin + i];
+			shardSse[s] += err * err;
+			if (abs(err) <= criterion) {
+				shardHits[s]++;
+			}
+		}
+	});
+
+	sse = 0.0;
+	hits = 0;
+	for (int s = 0; s < numShards; s++) {
+		sse += shardSse[s];
+		hits += shardHits[s];
+	}
+}
+
+
 ResultType GPProgram::getEvolvedGuesses() {
 	return evaluate(true);
 }
@@ -601,12 +734,22 @@ int GPProgram::getNumberOfHits(double hitsCriterion, bool  training) {
 
 	int ret = 0;
 
+	if (training && trainingStream() != 0) {
+		return streamNumberOfHits(*this, hitsCriterion);
+	}
+
+	if (shardSize > 0) {
+		double sse = 0.0;
+		evaluateShards(training, false, hitsCriterion, sse, ret);
+		return ret;
+	}
+
 	// depending on the value
 	if (training) {
-		ret = countHits(targets, (lsCoeffA + lsCoeffB * evaluate(true)), hitsCriterion);
+		ret = countHits(targets, (lsCoeffA + lsCoeffB * evaluate(true)), config->hitsCriterion);
 	}
 	else {
-		ret = countHits(test_targets, (lsCoeffA + lsCoeffB * evaluate(false)), hitsCriterion);
+		ret = countHits(test_targets, (lsCoeffA + lsCoeffB * evaluate(false)), config->hitsCriterion);
 	}
 	
 	return ret;
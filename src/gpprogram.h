@@ -212,6 +212,15 @@ class GPProgram {
 		 */
 		ResultType evaluate(bool training);
 
+		/**
+		 * Evaluate a GPProgram on a range of the fitness cases.
+		 * @param training a flag that specifies training (1) or testing (0). 
+		 * @param begin the first fitness case
+		 * @param end one past the last fitness case
+		 * @return an array of guesses for the cases begin .. end-1
+		 */
+		ResultType evaluate(bool training, int begin, int end);
+
 		/**
 		 * Calculate the fitness (Mean-squared error).
 		 * @param training a flag that specifies training (1) or testing (0). 
@@ -219,11 +228,31 @@ class GPProgram {
 		 */
 		double calcFitness(bool training);
 
+		/**
+		 * Calculate the fitness (Mean-squared error), with the potency decision 
+		 * already made by the caller. This does not touch the global rng, so it
+		 * is safe to call from worker threads.
+		 * @param training a flag that specifies training (1) or testing (0). 
+		 * @param applyScaling recalculate the LS coefficients (training only)
+		 * @return the fitness
+		 */
+		double calcFitness(bool training, bool applyScaling);
+
+		/**
+		 * Calculate the fitness (Mean-squared error) from guesses that have 
+		 * already been evaluated (e.g. in chunks, by several threads).
+		 * @param training a flag that specifies training (1) or testing (0). 
+		 * @param applyScaling recalculate the LS coefficients (training only)
+		 * @param guesses the output of evaluate() on the whole data set
+		 * @return the fitness
+		 */
+		double calcFitness(bool training, bool applyScaling, const ResultType &guesses);
+
 		/**
 		 * Performs Linear Scaling to produce 2 coefficients that act on the
 		 * GPProgram to improve its training performance.
 		 */
-		void linearScaling(const ResultType &evolved, const ResultType &target);
+		void linearScaling(const ResultType &evolved, const DataColumn &target);
 
 		/**
 		 * Gets the (training) guesses
@@ -253,6 +282,19 @@ class GPProgram {
 		bool sanityCheck();
 
 	private:
+		/**
+		 * Data-parallel evaluation: evaluate the program on fixed-size shards 
+		 * of the fitness cases (spread over the worker pool) and reduce the 
+		 * partial sums in shard order, so the result is the same whatever the
+		 * number of threads.
+		 * @param training a flag that specifies training (1) or testing (0). 
+		 * @param applyScaling recalculate the LS coefficients (training only)
+		 * @param criterion the hits criterion
+		 * @param sse set to the sum of squared errors
+		 * @param hits set to the number of hits
+		 */
+		void evaluateShards(bool training, bool applyScaling, double criterion, double &sse, int &hits);
+
 		std::vector<GPNode*> genome;
 		int size;
 		double fitness;
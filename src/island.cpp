@@ -0,0 +1,197 @@
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "island.h"
+#include "evolve.h"
+#include "genlog.h"
+#include "model.h"
+#include "spscqueue.h"
+#include "global.h"
+#include "usefulfunctions.h"
+#include "trace.h"
+
+using namespace std;
+
+// tags for the random streams derived from the run's seed, chosen so that
+// they never collide with the (generation, slot) streams of parallelBreed
+#define ISLAND_STREAM 0xffffffffUL
+#define MIGRATION_STREAM 0xfffffffeUL
+
+// one queue per (sender, receiver) pair, so that each has a single producer
+// and a single consumer
+static vector<SPSCQueue<GPProgram*>*> migrationQueues;
+
+static SPSCQueue<GPProgram*>& queueBetween(int from, int to) {
+	return *migrationQueues[from * numIslands + to];
+}
+
+/*
+ * The size of an island's share of the population.
+ */
+static int islandSize(int island) {
+	return config->popsize / numIslands + ((island < config->popsize % numIslands) ? 1 : 0);
+}
+
+/*
+ * The island that island sends its migrants to at the given generation
+ * (to itself means: no migration this time).
+ */
+static int destination(int island, int generation) {
+
+	if (migration_topology == "ring") {
+		return (island + 1) % numIslands;
+	}
+
+	// random: every island draws the same permutation
+	RNG r(RNG::streamSeed(seed, MIGRATION_STREAM, generation));
+	vector<int> perm(numIslands);
+	for (int i = 0; i < numIslands; i++) {
+		perm[i] = i;
+	}
+	for (int i = numIslands - 1; i > 0; i--) {
+		swap(perm[i], perm[r.intRandom(0, i)]);
+	}
+	return perm[island];
+}
+
+/*
+ * The island that sends its migrants to island at the given generation.
+ */
+static int source(int island, int generation) {
+	for (int i = 0; i < numIslands; i++) {
+		if (destination(i, generation) == island) {
+			return i;
+		}
+	}
+	return island;
+}
+
+/*
+ * Send copies of the best individuals to the destination island and replace
+ * the worst individuals with the migrants from the source island.
+ */
+static void migrate(GPPopulation &pop, int island, int generation) {
+
+	TRACE_SPAN("migration", generation);
+	int dest = destination(island, generation);
+	int src = source(island, generation);
+	// no more than the smaller island of each pair can take (the sizes
+	// differ by one), so the sender and the receiver agree on the count
+	int sendCount = min(migrationRate, min(islandSize(island), islandSize(dest)));
+	int receiveCount = min(migrationRate, min(islandSize(src), islandSize(island)));
+
+	// population indexes, best first
+	vector<int> order = pop.getRanking();
+
+	if (dest != island) {
+		for (int k = 0; k < sendCount; k++) {
+			GPProgram *migrant = new GPProgram(*(pop.getIndividual(order[k])));
+			while (!queueBetween(island, dest).push(migrant)) {
+				if (stopSignal != 0) {
+					delete migrant;		// the other island may have stopped
+					break;
+				}
+				this_thread::yield();
+			}
+		}
+	}
+
+	if (src != island) {
+		for (int k = 0; k < receiveCount; k++) {
+			GPProgram *migrant;
+			while (!queueBetween(src, island).pop(migrant)) {
+				if (stopSignal != 0) {
+					pop.updateBestIndividual();	// the other island may have stopped
+					return;
+				}
+				this_thread::yield();
+			}
+			pop.setIndividual(order[pop.getSize() - 1 - k], migrant);
+			delete migrant;
+		}
+		pop.updateBestIndividual();
+	}
+}
+
+/*
+ * The life of one island, on its own thread.
+ */
+static void evolveIsland(int island, int size, GPProgram **best) {
+
+	setTraceThreadName("island " + intToString(island));
+	ulong islandSeed = RNG::streamSeed(seed, ISLAND_STREAM, island);
+	rng.reseed(islandSeed);
+
+	GPPopulation pop(size, config->genomeSize);
+	seedPopulation(pop);
+	pop.calculatePopulationFitness();
+
+	GenerationLog logger(logfile + "." + intToString(island));
+	logger.write(0, evaluateBest(pop));
+
+	for (int i=1; i<=config->numgens; i++) {
+		GenerationResult result = evolveGeneration(pop, i, islandSeed);
+
+		if (migrationInterval > 0 && i % migrationInterval == 0 && i < config->numgens) {
+			migrate(pop, island, i);
+		}
+
+		logger.write(i, result);
+		if (stopSignal != 0) {
+			break;
+		}
+	}
+	logger.close();
+
+	*best = new GPProgram(*(pop.getBestIndividual()));
+}
+
+void runIslands() {
+
+	migrationQueues.resize(numIslands * numIslands);
+	for (unsigned i = 0; i < migrationQueues.size(); i++) {
+		migrationQueues[i] = new SPSCQueue<GPProgram*>(2 * migrationRate);
+	}
+
+	// share the population out between the islands
+	vector<GPProgram*> best(numIslands);
+	vector<thread> islands;
+	for (int i = 0; i < numIslands; i++) {
+		islands.push_back(thread(evolveIsland, i, islandSize(i), &best[i]));
+	}
+	for (int i = 0; i < numIslands; i++) {
+		islands[i].join();
+	}
+
+	int bestIsland = 0;
+	for (int i = 1; i < numIslands; i++) {
+		if (best[i]->getFitness() < best[bestIsland]->getFitness()) {
+			bestIsland = i;
+		}
+	}
+
+	// save best indy
+	std::ofstream the_best(best_file.c_str());
+	the_best << "# seed: " << seed << endl;
+	the_best << "# island: " << bestIsland << endl;
+	the_best << *(best[bestIsland]) << endl;
+	the_best.close();
+	saveModel(best_file, *(best[bestIsland]));
+
+	for (int i = 0; i < numIslands; i++) {
+		delete best[i];
+	}
+
+	// anything still in a queue was sent in the last migration and never collected
+	for (unsigned i = 0; i < migrationQueues.size(); i++) {
+		GPProgram *leftover;
+		while (migrationQueues[i]->pop(leftover)) {
+			delete leftover;
+		}
+		delete migrationQueues[i];
+	}
+	migrationQueues.clear();
+}
@@ -0,0 +1,28 @@
+/** \file island.h
+ * The island model.
+ * A number of populations (islands) evolve side by side, each on its own
+ * thread and with its own random stream. Every few generations each island
+ * sends copies of its best individuals to another island, where they
+ * replace the worst. Migrants travel over lock-free single-producer/
+ * single-consumer queues, one per (sender, receiver) pair.
+ *
+ * The destination of each island is fixed (ring topology: island i sends to
+ * island i+1) or drawn afresh at every migration from a random permutation
+ * that all islands derive from the run's seed (random topology). Since an
+ * island always waits for the migrants it is due, a run is reproducible
+ * from its seed.
+ */
+
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include <string>
+
+/**
+ * Run the island model with the global settings (numIslands, migration
+ * interval/rate/topology), logging each island to logfile.<island> and
+ * writing the best individual of the run to best_file.
+ */
+void runIslands();
+
+#endif
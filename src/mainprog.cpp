@@ -1,20 +1,225 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cctype>
 #include <unistd.h> 
 
 #include "global.h"
 #include "gppopulation.h"
 #include "gpoperators.h"
+#include "evolve.h"
+#include "island.h"
+#include "netmigration.h"
+#include "evalfarm.h"
+#include "steadystate.h"
+#include "multirun.h"
+#include "dataio.h"
+#include "genlog.h"
+#include "checkpoint.h"
+#include "model.h"
+#include "scorer.h"
+#include "exporter.h"
+#include "synthetic.h"
+#include "timing.h"
+#include "perfcounters.h"
+#include "trace.h"
 #include "usefulfunctions.h"
 #include "rng.h"
 
 using namespace std;
 
+/*
+ * gpsr convert in out: write a dataset in the binary format.
+ */
+static int convertDataset(int argc, char* argv[]) {
+
+	if (argc != 4) {
+		cerr << "usage: " << argv[0] << " convert datafile binaryfile" << endl;
+		return EXIT_FAILURE;
+	}
+	vector<DataColumn> vars;
+	DataColumn trg;
+	bool hasHeader;
+	int bad = readDataset(argv[2], vars, trg, hasHeader);
+	if (bad < 0) {
+		cerr << "Could not open datafile " << argv[2] << endl;
+		return EXIT_FAILURE;
+	}
+	if (bad > 0) {
+		cerr << "Something went wrong reading in " << argv[2] << endl;
+		cerr << "at line " << bad << endl;
+		return EXIT_FAILURE;
+	}
+	if (!writeBinaryDataset(argv[3], vars, trg)) {
+		cerr << "Could not write " << argv[3] << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ * gpsr generate [options] datafile: write a synthetic dataset.
+ */
+static int generateData(int argc, char* argv[]) {
+
+	SyntheticSpec spec;
+	bool binary = false;
+	bool rangeGiven = false;
+	bool badOption = false;
+	int c;
+	optind = 2;
+	while ((c = getopt(argc, argv, "n:v:e:F:l:u:D:b")) != -1) {
+		switch (c) {
+			case 'n': spec.rows = atol(optarg); break;
+			case 'v': spec.variables = atoi(optarg); break;
+			case 'e': spec.noise = atof(optarg); break;
+			case 'F': spec.formula = optarg; break;
+			case 'l': spec.low = atof(optarg); rangeGiven = true; break;
+			case 'u': spec.high = atof(optarg); rangeGiven = true; break;
+			case 'D': spec.seed = strtoul(optarg, 0, 10); break;
+			case 'b': binary = true; break;
+			default: badOption = true;
+		}
+	}
+	if (badOption || argc - optind != 1) {
+		cerr << "usage: " << argv[0] << " generate [options] datafile" << endl;
+		cerr << "  -n num      number of fitness cases (default: 1000)" << endl;
+		cerr << "  -v num      number of variables (default: as many as the formula uses)" << endl;
+		cerr << "  -e num      Gaussian noise on the targets, relative to their standard deviation (default: 0)" << endl;
+		cerr << "  -F formula  the target: an expression of x0, x1, .. or quartic, nguyen7 or friedman1 (default: quartic)" << endl;
+		cerr << "  -l num      lowest value of the variables (default: -1, or the formula's own)" << endl;
+		cerr << "  -u num      highest value of the variables (default: 1, or the formula's own)" << endl;
+		cerr << "  -D num      random seed (default: 1)" << endl;
+		cerr << "  -b          write the binary format" << endl;
+		return EXIT_FAILURE;
+	}
+
+	TargetFormula formula;
+	string error;
+	if (!rangeGiven && formula.parse(spec.formula, error)) {
+		formula.getRange(spec.low, spec.high);
+	}
+	vector<DataColumn> vars;
+	DataColumn trg;
+	if (!generateDataset(spec, vars, trg, error)) {
+		cerr << "Could not generate a dataset: " << error << endl;
+		return EXIT_FAILURE;
+	}
+	bool written = binary ? writeBinaryDataset(argv[optind], vars, trg) : writeTextDataset(argv[optind], vars, trg);
+	if (!written) {
+		cerr << "Could not write " << argv[optind] << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ * gpsr export [-n name] [-s library] [-t datafile] modelfile sourcefile:
+ * write a model as C++ source, and build and check it if asked to.
+ */
+static int exportModel(int argc, char* argv[]) {
+
+	string name = "gpsr_model";
+	string library = "";
+	string checkFile = "";
+	bool badOption = false;
+	int c;
+	optind = 2;
+	while ((c = getopt(argc, argv, "n:s:t:")) != -1) {
+		switch (c) {
+			case 'n': name = optarg; break;
+			case 's': library = optarg; break;
+			case 't': checkFile = optarg; break;
+			default: badOption = true;
+		}
+	}
+	if (badOption || argc - optind != 2 || (checkFile != "" && library == "")) {
+		cerr << "usage: " << argv[0] << " export [-n name] [-s library.so] [-t datafile] modelfile sourcefile" << endl;
+		cerr << "  -n name      the name of the functions (default: gpsr_model)" << endl;
+		cerr << "  -s library   build the source into a shared object" << endl;
+		cerr << "  -t datafile  check that the shared object predicts datafile as gpsr does" << endl;
+		return EXIT_FAILURE;
+	}
+	bool identifier = name != "" && !isdigit(name[0]);
+	for (unsigned i = 0; i < name.size(); i++) {
+		identifier = identifier && (isalnum(name[i]) || name[i] == '_');
+	}
+	if (!identifier) {
+		cerr << name << " is not a C identifier" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ifstream in(argv[optind]);
+	SavedModel model;
+	string error;
+	if (!in || !readSavedModel(in, model, error) || !CompiledModel(model).ok()) {
+		cerr << "Could not read a model from " << argv[optind] << (error != "" ? ": " + error : "") << endl;
+		return EXIT_FAILURE;
+	}
+	std::ofstream source(argv[optind + 1]);
+	writeModelSource(source, model, name);
+	source.close();
+	if (!source) {
+		cerr << "Could not write " << argv[optind + 1] << endl;
+		return EXIT_FAILURE;
+	}
+
+	if (library != "" && !buildSharedObject(argv[optind + 1], library)) {
+		cerr << "Could not build " << library << endl;
+		return EXIT_FAILURE;
+	}
+	if (checkFile != "") {
+		double maxDiff;
+		long differ = verifySharedObject(library, name, model, checkFile, maxDiff);
+		if (differ < 0) {
+			return EXIT_FAILURE;
+		}
+		if (differ > 0) {
+			cerr << differ << " of " << test_targets.size() << " predictions differ from gpsr's (by up to " << maxDiff << ")" << endl;
+			return EXIT_FAILURE;
+		}
+		cout << "all " << test_targets.size() << " predictions are the same as gpsr's" << endl;
+	}
+	return EXIT_SUCCESS;
+}
+
 int main( int argc, char* argv[] ) {
 
+	if (argc > 1 && string(argv[1]) == "convert") {
+		return convertDataset(argc, argv);
+	}
+	if (argc > 1 && string(argv[1]) == "generate") {
+		return generateData(argc, argv);
+	}
+	if (argc > 1 && string(argv[1]) == "export") {
+		return exportModel(argc, argv);
+	}
+	if (argc > 1 && string(argv[1]) == "printlog") {
+		if (argc != 3) {
+			cerr << "usage: " << argv[0] << " printlog resultsfile" << endl;
+			return EXIT_FAILURE;
+		}
+		if (!printBinaryLog(argv[2], cout)) {
+			cerr << argv[2] << " is not a binary results file" << endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	setupGlobals(argc, argv);
-	loadFiles(training_file, testing_file);
+#ifdef GPSR_NO_TIMING
+	if (trace_file != "") {
+		cerr << "This gpsr was built without timing (GPSR_NO_TIMING), so it can't --trace" << endl;
+		exit(1);
+	}
+#endif
+	if (trace_file != "") {
+		startTracing(trace_file);
+	}
+	{
+		TRACE_SPAN("load data");
+		loadFiles(training_file, testing_file);
+	}
 	setupNodeLists();
 
 
@@ -22,92 +227,202 @@ int main( int argc, char* argv[] ) {
 		seed = time(0) ^ (getpid() << 16);
 	}
 	rng.reseed(seed);
+	loadSeedModels(seed_files);
+
+	// carry on a checkpointed run (with its seed and random numbers)
+	GPPopulation *pop = 0;
+	int firstGen = 1;
+	if (resume_file != "") {
+		pop = new GPPopulation(0);
+		int generation;
+		if (!readCheckpoint(resume_file, *pop, generation)) {
+			exit(1);
+		}
+		firstGen = generation + 1;
+	}
 
 	printSettings();
 
-	int best1 = 0;
-	int best2 = 0;
-	int worst = 0;
-	double fit1 = 0.0;
-	double fit2 = 0.0;
+	bool farmed = localWorkers > 0 || !farm_workers.empty();
+	if (farmed && numIslands > 1) {
+		cerr << "Evaluation workers can't be used with islands (-I)" << endl;
+		exit(1);
+	}
+	if (steady_state && (farmed || numIslands > 1 || migration_listen != "" || !migration_destinations.empty())) {
+		cerr << "--steady-state can't be combined with islands, migration or evaluation workers" << endl;
+		exit(1);
+	}
+	bool sweeping = sweep_spec != "" || sweep_file != "";
+	if ((numRuns > 1 || sweeping) && (steady_state || farmed || numIslands > 1 || migration_listen != "" || !migration_destinations.empty())) {
+		cerr << "--runs and --sweep can't be combined with --steady-state, islands, migration or evaluation workers" << endl;
+		exit(1);
+	}
+	if (streamChunk > 0 && (sweeping || numRuns > 1 || steady_state || farmed || numIslands > 1 || migration_listen != "" || !migration_destinations.empty() || shardSize > 0 || train_with_noise)) {
+		cerr << "--stream is for single generational runs (no --runs, --sweep, --steady-state, islands, migration, evaluation workers, -S or -J)" << endl;
+		exit(1);
+	}
+	if ((checkpoint_file != "" || resume_file != "") && (sweeping || numRuns > 1 || steady_state || numIslands > 1 || migration_listen != "" || !migration_destinations.empty() || checkpointInterval <= 0)) {
+		cerr << "--checkpoint and --resume are for single generational runs (no --runs, --sweep, --steady-state, islands or migration)" << endl;
+		exit(1);
+	}
+	if ((timing_file != "" || perf_file != "") && (sweeping || numRuns > 1 || steady_state || numIslands > 1)) {
+		cerr << "--timing-log and --perf-log are for single generational runs (no --runs, --sweep, --steady-state or islands)" << endl;
+		exit(1);
+	}
+#ifdef GPSR_NO_TIMING
+	if (timing_file != "" || perf_file != "") {
+		cerr << "This gpsr was built without timing (GPSR_NO_TIMING), so it can't write --timing-log or --perf-log" << endl;
+		exit(1);
+	}
+#endif
+	catchStopSignals();
+	if (sweeping) {
+		vector<SweepConfig> configs;
+		if ((sweep_spec != "" && !expandSweep(sweep_spec, configs)) || (sweep_file != "" && !readSweepFile(sweep_file, configs))) {
+			exit(1);
+		}
+		runSweep(configs, numRuns);
+		cleanup();
+		return exitStatus();
+	}
+	if (numRuns > 1) {
+		runBatch(numRuns);
+		cleanup();
+		return exitStatus();
+	}
+	if (farmed) {
+		startEvaluationFarm(argv);
+	}
 
-	int trainHits = 0;
-	int testHits = 0;
+	if (numIslands > 1) {
+		if (migration_listen != "" || !migration_destinations.empty()) {
+			cerr << "Migration between processes is for single-population runs (one island per process)" << endl;
+			exit(1);
+		}
+		runIslands();
+		cleanup();
+		return exitStatus();
+	}
+
+	// hardware counters, if the machine has them and they are allowed
+	if (perf_file != "") {
+		string error;
+		if (!startPerfCounters(error)) {
+			cerr << "No hardware counters (" << error << "), so no " << perf_file << endl;
+		}
+	}
 
 	// create population
-	GPPopulation *pop = new GPPopulation(popsize, genomeSize);
-	pop->calculatePopulationFitness();
+	startGenerationTiming();
+	startGenerationCounters();
+	if (pop == 0) {
+		pop = new GPPopulation(config->popsize, config->genomeSize);
+		seedPopulation(*pop);
+		COUNT_PHASE(COUNTED_FITNESS);
+		TIME_PHASE(PHASE_FITNESS);
+		pop->calculatePopulationFitness();
+	}
+
+	// (a resumed run keeps what was logged up to its checkpoint)
+	GenerationLog logger(logfile, firstGen > 1 ? firstGen : 0);
+	if (firstGen == 1) {
+		logger.write(0, evaluateBest(*pop));
+	}
 
-	best1 = pop->getIndexOfBest();
+	std::ofstream timing;
+	if (timing_file != "") {
+		if (firstGen > 1) {
+			reopenLog(timing, timing_file, firstGen - 1);
+		}
+		else {
+			timing.open(timing_file.c_str(), ios::trunc);
+			writeTimingHeader(timing);
+			writeTiming(timing, 0, getGenerationTiming());
+		}
+	}
 
-	double trainPerf = pop->getIndividual(best1)->getFitness();
-	double testPerf = pop->getIndividual(best1)->getTestFitness();
+	std::ofstream counters;
+	if (perfCountersRunning()) {
+		if (firstGen > 1) {
+			// the totals carry on from the counts up to the checkpoint
+			resumePerfCounters(reopenLog(counters, perf_file, firstGen - 1));
+		}
+		else {
+			counters.open(perf_file.c_str(), ios::trunc);
+			writePerfHeader(counters);
+			writePerfCounters(counters, 0, getGenerationTiming().nodes);
+		}
+	}
 
-	trainHits = pop->getIndividual(best1)->getNumberOfHits(hitsCriterion, true);
-	testHits = pop->getIndividual(best1)->getNumberOfHits(hitsCriterion, false);
+	std::ofstream utilisation;
+	if (utilisation_file != "") {
+		if (firstGen > 1) {
+			reopenLog(utilisation, utilisation_file, firstGen - 1);
+		}
+		else {
+			utilisation.open(utilisation_file.c_str(), ios::trunc);
+			logUtilisation(utilisation, 0);
+		}
+	}
 
-	std::ofstream logger(logfile.c_str());
-	logger << "0\t" << 1.0 / (1.0 + trainPerf) << "\t" << 1.0 / (1.0 + testPerf) << "\t" << ( (double) (trainHits) / (double) targets.size() ) << "\t" << ( (double) testHits / (double) test_targets.size() )<< "\t" << trainPerf << "\t" << testPerf << endl;
-	logger.flush();
+	CheckpointWriter *checkpoints = 0;
+	if (checkpoint_file != "") {
+		checkpoints = new CheckpointWriter(checkpoint_file);
+	}
+
+	// this process is one island among several
+	SocketMigration *migration = 0;
+	if (migration_listen != "" || !migration_destinations.empty()) {
+		migration = new SocketMigration(migration_listen, migration_destinations);
+	}
 
 	GPProgram* elite;
 
-	for (int i=1; i<=numgens; i++) {
+	if (steady_state) {
+		runSteadyState(*pop, logger, logInterval);
+	}
+	else {
+		for (int i=firstGen; i<=config->numgens; i++) {
 
-		// update global current gen counter
-		currentgen = i;
+			startGenerationTiming();
+			startGenerationCounters();
+			GenerationResult result = evolveGeneration(*pop, i, seed);
 
-		best1 = pop->getIndexOfBest();
-		elite = new GPProgram(*(pop->getIndividual(best1)));
-		fit1 = elite->getFitness();
+			if (migration != 0 && migrationInterval > 0 && i % migrationInterval == 0 && i < config->numgens) {
+				TIME_PHASE(PHASE_MIGRATION);
+				migration->exchange(*pop, migrationRate);
+			}
 
-		// do operators
-		tournamentSelection(*pop);
-		crossover(*pop);
-		mutation(*pop);
+			{
+				TIME_PHASE(PHASE_LOGGING);
+				if (utilisation.is_open()) {
+					logUtilisation(utilisation, i);
+				}
+				logger.write(i, result);
+			}
 
-		// calculate fitness
-		pop->calculatePopulationFitness();
-		best2 = pop->getIndexOfBest();
-		fit2 = pop->getIndividualFitness(best2);
-
-		if (fit1 < fit2) {
-			
-			// selection and operators did not produce a beter
-			// individual, so we should keep the previous best. 
-			// We do this by replacing the current worst with
-			// the old best
-		
-			// find current worst
-			worst = pop->getIndexOfWorst();
-			
-			// update that individual with the previous best
-			pop->setIndividual(worst, elite);
-
-			// training and testing performance should  therefore 
-			// be taken from the previous best
-			trainPerf = fit1;
-			testPerf = elite->getTestFitness();
-
-			// the previous best overwrites the old worst, so we update the indexes
-			pop->setIndexOfBest(worst);
-			
-			// get the hits
-			trainHits = pop->getIndividual(worst)->getNumberOfHits(hitsCriterion, true);
-			testHits = pop->getIndividual(worst)->getNumberOfHits(hitsCriterion, false);
-		}
-		else {
-			trainPerf = fit2;
-			testPerf = pop->getIndividual(best2)->getTestFitness();
-	
-			// get the hits
-			trainHits = pop->getIndividual(best2)->getNumberOfHits(hitsCriterion, true);
-			testHits = pop->getIndividual(best2)->getNumberOfHits(hitsCriterion, false);
+			// (a run that is stopped checkpoints where it stops)
+			if (checkpoints != 0 && (i % checkpointInterval == 0 || stopSignal != 0)) {
+				TIME_PHASE(PHASE_CHECKPOINT);
+				// the log must never be behind the checkpoint it resumes from
+				logger.flush();
+				checkpoints->save(*pop, i);
+			}
 
-		}
+			GenerationTiming times = getGenerationTiming();
+			if (timing.is_open()) {
+				writeTiming(timing, i, times);
+			}
+			if (counters.is_open()) {
+				writePerfCounters(counters, i, times.nodes);
+			}
 
-		logger << i << "\t" << 1.0 / (1.0 + trainPerf) << "\t" << 1.0 / (1.0 + testPerf) << "\t" << ( (double) (trainHits) / (double) targets.size() ) << "\t" << ( (double) testHits / (double) test_targets.size() ) << "\t" << trainPerf << "\t" << testPerf << endl;
+			if (stopSignal != 0) {
+				break;
+			}
+		}
 	}
+	delete checkpoints;
 
 	// save best indy
 	std::ofstream the_best(best_file.c_str());
@@ -116,12 +431,21 @@ int main( int argc, char* argv[] ) {
 	the_best << *elite << endl;
 	the_best.flush();
 	the_best.close();
-	logger.flush();
+	saveModel(best_file, *elite);
 	logger.close();
+	utilisation.close();
+	timing.close();
+	if (perfCountersRunning()) {
+		counters.close();
+		stopPerfCounters();
+		printPerfSummary(cout);
+	}
 
+	delete migration;
 	delete elite;
 	delete pop;
+	stopEvaluationFarm();
 	cleanup();
 
-	return EXIT_SUCCESS;
+	return exitStatus();
 }
@@ -0,0 +1,209 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <limits>
+#include <map>
+
+#include "model.h"
+#include "serialize.h"
+#include "global.h"
+
+using namespace std;
+
+/* the models read with loadSeedModels() */
+static vector<GPProgram*> seedModels;
+
+void writeModel(std::ostream &os, const GPProgram &prog) {
+
+	ostringstream s;
+	s << setprecision(numeric_limits<double>::max_digits10);
+	s << "model" << endl;
+	s << "fitness " << prog.getFitness() << endl;
+	s << "scaling " << prog.getLSCoeffA() << " " << prog.getLSCoeffB() << endl;
+
+	map<int, double> used;
+	s << "genome";
+	for (int i = 0; i < prog.getSize(); i++) {
+		GPNode *node = prog.getNode(i);
+		if (node->getType() == "VAR") {
+			s << " x" << node->getData();
+		}
+		else if (node->getType() == "constant") {
+			s << " c" << node->getData();
+			used[node->getData()] = constants[node->getData()];
+		}
+		else {
+			s << " " << node->getType();
+		}
+	}
+	s << endl;
+	for (map<int, double>::iterator it = used.begin(); it != used.end(); it++) {
+		s << "constant " << it->first << " " << it->second << endl;
+	}
+	s << "end" << endl;
+	os << s.str();
+}
+
+/*
+ * The opcode and data index of a genome token (OP_INVALID if it isn't one).
+ */
+static Opcode parseToken(const string &token, int &data) {
+
+	data = 0;
+	if (token.size() > 1 && (token[0] == 'x' || token[0] == 'c')) {
+		char *end;
+		long n = strtol(token.c_str() + 1, &end, 10);
+		if (*end != '\0' || n < 0 || n > 0x7fffffff) {
+			return OP_INVALID;
+		}
+		data = n;
+		return (token[0] == 'x') ? OP_VAR : OP_CONSTANT;
+	}
+	Opcode op = typeToOpcode(token);
+	return (op == OP_VAR || op == OP_CONSTANT) ? OP_INVALID : op;
+}
+
+bool readSavedModel(std::istream &is, SavedModel &model, std::string &error) {
+
+	error = "";
+	string line;
+	bool inModel = false;
+	bool haveGenome = false;
+	model.fitness = 0.0;
+	model.lsCoeffA = 0.0;
+	model.lsCoeffB = 1.0;
+	model.ops.clear();
+	model.data.clear();
+	model.constants.clear();
+
+	while (getline(is, line)) {
+		stringstream fields(line);
+		string key;
+		if (!(fields >> key) || key[0] == '#') {
+			continue;
+		}
+		if (!inModel) {
+			if (key != "model") {
+				error = "expected 'model', found '" + line + "'";
+				return false;
+			}
+			inModel = true;
+			continue;
+		}
+
+		if (key == "fitness") {
+			fields >> model.fitness;
+		}
+		else if (key == "scaling") {
+			fields >> model.lsCoeffA >> model.lsCoeffB;
+		}
+		else if (key == "genome") {
+			string token;
+			while (fields >> token) {
+				int d;
+				Opcode op = parseToken(token, d);
+				if (op == OP_INVALID) {
+					error = "unknown node '" + token + "'";
+					return false;
+				}
+				model.ops.push_back(op);
+				model.data.push_back(d);
+			}
+			fields.clear();		// (read to the end)
+			haveGenome = true;
+		}
+		else if (key == "constant") {
+			int index;
+			double value;
+			fields >> index >> value;
+			if (!fields.fail() && index < 0) {
+				error = "bad constant number in '" + line + "'";
+				return false;
+			}
+			model.constants[index] = value;
+		}
+		else if (key == "end") {
+			if (!haveGenome) {
+				error = "model without a genome";
+				return false;
+			}
+			return true;
+		}
+		else {
+			error = "unknown line '" + line + "'";
+			return false;
+		}
+		if (fields.fail()) {
+			error = "bad line '" + line + "'";
+			return false;
+		}
+	}
+
+	if (inModel) {
+		error = "model without an end";
+	}
+	return false;
+}
+
+bool readModel(std::istream &is, GPProgram &prog, std::string &error) {
+
+	SavedModel model;
+	if (!readSavedModel(is, model, error)) {
+		return false;
+	}
+	for (map<int, double>::iterator it = model.constants.begin(); it != model.constants.end(); it++) {
+		int local = constants.empty() ? 0 : localConstant(it->first, it->second);
+		if (!constants.empty() && constants[local] != it->second) {
+			cerr << "Warning: model constant " << it->second << " replaced by " << constants[local]
+				<< " (use the -j and -r settings of the run that saved the model)" << endl;
+		}
+	}
+	if (!buildGenome(model.ops, model.data, model.constants, prog)) {
+		error = "the genome doesn't fit this run (other unaries or variables, or a constant missing)";
+		return false;
+	}
+	prog.setFitness(model.fitness);
+	prog.setLSCoeffA(model.lsCoeffA);
+	prog.setLSCoeffB(model.lsCoeffB);
+	return true;
+}
+
+void saveModel(const std::string &bestFile, const GPProgram &prog) {
+	std::ofstream model((bestFile + ".model").c_str());
+	writeModel(model, prog);
+}
+
+void loadSeedModels(const std::vector<std::string> &filenames) {
+
+	for (unsigned i = 0; i < filenames.size(); i++) {
+		ifstream in(filenames[i].c_str());
+		if (!in) {
+			cerr << "Could not open model file " << filenames[i] << endl;
+			exit(1);
+		}
+		GPProgram *prog = new GPProgram();
+		string error;
+		while (readModel(in, *prog, error)) {
+			seedModels.push_back(prog);
+			prog = new GPProgram();
+		}
+		delete prog;
+		if (error != "") {
+			cerr << "Could not read model file " << filenames[i] << ": " << error << endl;
+			exit(1);
+		}
+	}
+}
+
+void seedPopulation(GPPopulation &pop) {
+
+	int n = min((int) seedModels.size(), pop.getSize());
+	if ((int) seedModels.size() > n) {
+		cerr << "Warning: only the first " << n << " seed models fit in the population" << endl;
+	}
+	for (int i = 0; i < n; i++) {
+		delete pop.swapIndividual(i, new GPProgram(*seedModels[i]));
+	}
+}
@@ -0,0 +1,98 @@
+/** \file model.h
+ * Saved models: individuals written in a text format that can be read
+ * back, e.g. to seed new runs with them (--seed-population).
+ *
+ * A model file holds one or more models, each of the form
+ *
+ *     model
+ *     fitness 0.0123
+ *     scaling -0.5 1.25
+ *     genome x0 x0 MUL c3 ADD SIN
+ *     constant 3 -2.8713905520999998
+ *     end
+ *
+ * The genome is postfix, with xN for variable N, cN for constant N and the
+ * node types (ADD, MIN, MUL, DIV, SQR, COS, SIN, LOG) for the functions.
+ * Scaling holds the LS coefficients (a and b: the model is a + b * genome),
+ * and there is a constant line, giving its value, for each constant the
+ * genome uses. Numbers are written with all their digits, so a model reads
+ * back exactly. Lines starting with # are comments.
+ *
+ * When a model is read, its constants are mapped onto the constants of the
+ * run (see serialize.h): runs with the same -j and -r settings have the
+ * same constants.
+ */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <istream>
+
+#include "gppopulation.h"
+
+/**
+ * Write an individual as a model.
+ * @param os where to write it
+ * @param prog the individual
+ */
+void writeModel(std::ostream &os, const GPProgram &prog);
+
+/**
+ * A model as it was saved, independent of the node lists of this process.
+ */
+struct SavedModel {
+	double fitness;
+	double lsCoeffA;
+	double lsCoeffB;
+	std::vector<unsigned char> ops;		// the opcodes of the postfix genome (serialize.h)
+	std::vector<int> data;			// the variable or constant number of each node
+	std::map<int, double> constants;	// the values of the constants used
+};
+
+/**
+ * Read the next model as it was saved.
+ * @param is where to read it from
+ * @param model set to the model
+ * @param error set to what is wrong, if the model can't be read
+ * @return false at the end of the input, or (with an error) if the model
+ * can't be read
+ */
+bool readSavedModel(std::istream &is, SavedModel &model, std::string &error);
+
+/**
+ * Read the next model as an individual of this run.
+ * @param is where to read it from
+ * @param prog set to the model
+ * @param error set to what is wrong, if the model can't be read
+ * @return false at the end of the input, or (with an error) if the model
+ * can't be read
+ */
+bool readModel(std::istream &is, GPProgram &prog, std::string &error);
+
+/**
+ * Write the best individual of a run to the model file that goes with its
+ * best file (best_file.model).
+ * @param bestFile the best file
+ * @param prog the best individual
+ */
+void saveModel(const std::string &bestFile, const GPProgram &prog);
+
+/**
+ * Read the models to seed populations with (--seed-population). Exits if a
+ * file can't be read.
+ * @param filenames the model files
+ */
+void loadSeedModels(const std::vector<std::string> &filenames);
+
+/**
+ * Put copies of the seed models into a new population, in place of its
+ * first (randomly created) individuals.
+ * @param pop the population (before its fitness is calculated)
+ */
+void seedPopulation(GPPopulation &pop);
+
+#endif
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+
+#include "multirun.h"
+#include "evolve.h"
+#include "genlog.h"
+#include "model.h"
+#include "threadpool.h"
+#include "global.h"
+#include "usefulfunctions.h"
+
+using namespace std;
+
+/*
+ * One run with the current thread's settings, from initialisation to the
+ * final generation.
+ * @param log where to log each generation (0 for nowhere)
+ * @param best set to a copy of the best individual (the caller deletes it)
+ */
+static GenerationResult runOnce(ulong runSeed, GenerationLog *log, GPProgram **best) {
+
+	rng.reseed(runSeed);
+	// the thread may have run generations of another run before
+	currentgen = 0;
+
+	GPPopulation pop(config->popsize, config->genomeSize);
+	seedPopulation(pop);
+	pop.calculatePopulationFitness();
+
+	GenerationResult result = evaluateBest(pop);
+	if (log != 0) {
+		log->write(0, result);
+	}
+
+	for (int i=1; i<=config->numgens; i++) {
+		result = evolveGeneration(pop, i, runSeed);
+		if (log != 0) {
+			log->write(i, result);
+		}
+		if (stopSignal != 0) {
+			break;
+		}
+	}
+
+	*best = new GPProgram(*(pop.getBestIndividual()));
+	return result;
+}
+
+void runBatch(int numRuns) {
+
+	vector<GenerationResult> results(numRuns);
+	vector<int> sizes(numRuns);
+
+	// whole runs are the tasks; their own evaluation runs inline
+	workerPool().run(numRuns, [&](int r) {
+		GenerationLog logger(logfile + "." + intToString(r + 1));
+		GPProgram *best;
+		results[r] = runOnce(seed + r, &logger, &best);
+		logger.close();
+		sizes[r] = best->getSize();
+
+		std::ofstream the_best((best_file + "." + intToString(r + 1)).c_str());
+		the_best << "# seed: " << (seed + r) << endl;
+		the_best << *best << endl;
+		the_best.close();
+		saveModel(best_file + "." + intToString(r + 1), *best);
+		delete best;
+	});
+
+	std::ofstream summary((logfile + ".summary").c_str());
+	summary << "# run\tseed\ttrain\ttest\ttrainHits\ttestHits\tsize" << endl;
+
+	int bestRun = 0;
+	double meanTrain = 0.0, meanTest = 0.0;
+	for (int r = 0; r < numRuns; r++) {
+		summary << (r + 1) << "\t" << (seed + r) << "\t" << results[r].trainPerf << "\t" << results[r].testPerf
+			<< "\t" << results[r].trainHits << "\t" << results[r].testHits << "\t" << sizes[r] << endl;
+		meanTrain += results[r].trainPerf / numRuns;
+		meanTest += results[r].testPerf / numRuns;
+		if (results[r].trainPerf < results[bestRun].trainPerf) {
+			bestRun = r;
+		}
+	}
+	summary.close();
+
+	cout << "runs:                  " << numRuns << " (summary in " << logfile << ".summary)" << endl;
+	cout << "mean train/test MSE:   " << meanTrain << " / " << meanTest << endl;
+	cout << "best run:              " << (bestRun + 1) << " (train " << results[bestRun].trainPerf
+		<< ", test " << results[bestRun].testPerf << ")" << endl;
+}
+
+bool expandSweep(const std::string &spec, std::vector<SweepConfig> &configs) {
+
+	// the settings, each with its values
+	vector<char> options;
+	vector<vector<string> > values;
+
+	string s = spec;
+	for (unsigned i = 0; i < s.size(); i++) {
+		if (s[i] == ';' || s[i] == '\t') {
+			s[i] = ' ';
+		}
+	}
+	stringstream in(s);
+	string setting;
+	while (in >> setting) {
+		if (setting.size() < 3 || setting[1] != '=') {
+			cerr << "Bad sweep setting " << setting << " (use option=value,value,...)" << endl;
+			return false;
+		}
+		options.push_back(setting[0]);
+		values.push_back(vector<string>());
+		stringstream list(setting.substr(2));
+		string value;
+		while (getline(list, value, ',')) {
+			RunConfig check;
+			if (!setConfigOption(check, setting[0], value.c_str())) {
+				cerr << "Bad sweep setting " << setting << endl;
+				return false;
+			}
+			values.back().push_back(value);
+		}
+	}
+
+	// every combination, the last setting varying fastest
+	vector<unsigned> pick(options.size(), 0);
+	for (;;) {
+		SweepConfig sc;
+		sc.config = baseConfig;
+		for (unsigned k = 0; k < options.size(); k++) {
+			setConfigOption(sc.config, options[k], values[k][pick[k]].c_str());
+			sc.label += (k > 0 ? " " : "") + string(1, options[k]) + "=" + values[k][pick[k]];
+		}
+		if (sc.label == "") {
+			sc.label = "-";
+		}
+		configs.push_back(sc);
+
+		int k = options.size() - 1;
+		while (k >= 0 && ++pick[k] == values[k].size()) {
+			pick[k] = 0;
+			k--;
+		}
+		if (k < 0) {
+			break;
+		}
+	}
+	return true;
+}
+
+bool readSweepFile(const std::string &filename, std::vector<SweepConfig> &configs) {
+
+	ifstream in(filename.c_str());
+	if (!in) {
+		cerr << "Could not open sweep file " << filename << endl;
+		return false;
+	}
+	string line;
+	while (getline(in, line)) {
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == string::npos) {
+			continue;
+		}
+		if (!expandSweep(line, configs)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void runSweep(const std::vector<SweepConfig> &configs, int numRuns) {
+
+	std::ofstream table((logfile + ".sweep").c_str());
+	table << "# config\tsettings\tseed\ttrain\ttest\ttrainHits\ttestHits\tsize" << endl;
+	mutex tableLock;
+
+	// one task per (configuration, seed), costed by the work a run does
+	int numTasks = configs.size() * numRuns;
+	vector<double> costs(numTasks);
+	for (int k = 0; k < numTasks; k++) {
+		const RunConfig &c = configs[k / numRuns].config;
+		costs[k] = (double) c.popsize * c.numgens;
+	}
+
+	workerPool().run(costs, [&](int k) {
+		int c = k / numRuns;
+		ulong runSeed = seed + k % numRuns;
+
+		// this thread works with the configuration's settings for now
+		config = &(configs[c].config);
+		GPProgram *best;
+		GenerationResult result = runOnce(runSeed, 0, &best);
+		config = &baseConfig;
+
+		lock_guard<mutex> lock(tableLock);
+		table << (c + 1) << "\t" << configs[c].label << "\t" << runSeed << "\t" << result.trainPerf << "\t" << result.testPerf
+			<< "\t" << result.trainHits << "\t" << result.testHits << "\t" << best->getSize() << endl;
+		delete best;
+	});
+
+	table.close();
+	cout << "sweep:                 " << configs.size() << " configurations x " << numRuns << " seeds (results in "
+		<< logfile << ".sweep)" << endl;
+}
@@ -0,0 +1,66 @@
+/** \file multirun.h
+ * Batches of independent runs.
+ * Runs a number of independent runs of GP, each with its own seed (and, in
+ * a sweep, its own settings), side by side on the worker pool of one
+ * process, sharing one copy of the data and node lists instead of starting
+ * a process (and loading the data) per run. Each run behaves exactly as a
+ * separate gpsr process started with its seed and settings would.
+ */
+
+#ifndef MULTIRUN_H
+#define MULTIRUN_H
+
+#include <string>
+#include <vector>
+#include "global.h"
+
+/**
+ * One configuration of a sweep.
+ */
+struct SweepConfig {
+	RunConfig config;	// the settings
+	std::string label;	// how they differ from the command line's (e.g. "x=0.9 l=1")
+};
+
+/**
+ * Run numRuns independent runs with the global settings, run r (from 1)
+ * being seeded with seed + r - 1. Run r is logged to logfile.r and its best
+ * individual written to best_file.r; the final performance of every run is
+ * collected in logfile.summary.
+ * @param numRuns the number of runs
+ */
+void runBatch(int numRuns);
+
+/**
+ * Expand a sweep specification into configurations. The specification is a
+ * list of settings separated by spaces or semicolons, each an option letter
+ * (as on the command line: g, p, x, m, t, n, l, s, P or c) with a
+ * comma-separated list of values, e.g. "x=0.5,0.9 t=3,7 l=0,1"; every
+ * combination of values (the grid) is added to configs, starting from
+ * baseConfig.
+ * @param spec the specification
+ * @param configs the configurations to add to
+ * @return false if the specification is malformed
+ */
+bool expandSweep(const std::string &spec, std::vector<SweepConfig> &configs);
+
+/**
+ * Read sweep configurations from a file, one specification (as for
+ * expandSweep) per line; # starts a comment.
+ * @param filename the file
+ * @param configs the configurations to add to
+ * @return false if the file can't be read or a line is malformed
+ */
+bool readSweepFile(const std::string &filename, std::vector<SweepConfig> &configs);
+
+/**
+ * Run every configuration with numRuns seeds (seed .. seed + numRuns - 1),
+ * all on the worker pool, the biggest runs first. A line with the final
+ * performance of each run is added to logfile.sweep as soon as the run
+ * finishes.
+ * @param configs the configurations
+ * @param numRuns the number of seeds per configuration
+ */
+void runSweep(const std::vector<SweepConfig> &configs, int numRuns);
+
+#endif
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <cstdlib>
+#include <poll.h>
+
+#include "netmigration.h"
+#include "serialize.h"
+#include "socketio.h"
+#include "global.h"
+
+using namespace std;
+
+/* first word of a migration message */
+#define MIGRATION_MAGIC 0x4d505347	// "GSPM"
+
+/* how many messages/migrants may wait in the queues before we start dropping them */
+#define MIGRATION_QUEUE_SIZE 256
+
+/* how long to wait for a peer to accept a connection (ms), so that an
+   unreachable one can't hold up the I/O thread, and with it shutdown */
+#define CONNECT_TIMEOUT_MS 500
+
+SocketMigration::SocketMigration(const std::string &listenAddress, const std::vector<std::string> &destinations) :
+	outbox(MIGRATION_QUEUE_SIZE), inbox(MIGRATION_QUEUE_SIZE) {
+
+	this->listenFd = -1;
+	if (listenAddress != "") {
+		this->listenFd = listenOn(listenAddress);
+		if (this->listenFd < 0) {
+			exit(1);
+		}
+	}
+	this->destinations = destinations;
+	this->destinationFds.assign(destinations.size(), -1);
+	this->nextDestination = 0;
+	this->stopping = false;
+
+	io = thread(&SocketMigration::ioLoop, this);
+}
+
+SocketMigration::~SocketMigration() {
+	stopping = true;
+	io.join();
+
+	closeSocket(listenFd);
+	for (unsigned i = 0; i < clients.size(); i++) {
+		closeSocket(clients[i]);
+	}
+	for (unsigned i = 0; i < destinationFds.size(); i++) {
+		closeSocket(destinationFds[i]);
+	}
+
+	std::string *msg;
+	while (outbox.pop(msg)) {
+		delete msg;
+	}
+	GPProgram *migrant;
+	while (inbox.pop(migrant)) {
+		delete migrant;
+	}
+}
+
+void SocketMigration::send(const std::vector<GPProgram*> &migrants) {
+
+	if (destinations.empty()) {
+		return;
+	}
+
+	ByteWriter w;
+	w.putU32(MIGRATION_MAGIC);
+	w.putVarint(migrants.size());
+	for (unsigned i = 0; i < migrants.size(); i++) {
+		writeProgram(w, *(migrants[i]));
+	}
+
+	std::string *msg = new std::string(w.data());
+	if (!outbox.push(msg)) {
+		// the I/O thread is behind (slow peer): drop it
+		delete msg;
+	}
+}
+
+std::vector<GPProgram*> SocketMigration::receive() {
+	std::vector<GPProgram*> ret;
+	GPProgram *migrant;
+	while (inbox.pop(migrant)) {
+		ret.push_back(migrant);
+	}
+	return ret;
+}
+
+void SocketMigration::exchange(GPPopulation &pop, int count) {
+
+	vector<int> order = pop.getRanking();
+	if (count > pop.getSize()) {
+		count = pop.getSize();
+	}
+
+	vector<GPProgram*> emigrants;
+	for (int k = 0; k < count; k++) {
+		emigrants.push_back(pop.getIndividual(order[k]));
+	}
+	send(emigrants);
+
+	// immigrants replace the worst, as many as have arrived
+	vector<GPProgram*> immigrants = receive();
+	for (unsigned k = 0; k < immigrants.size(); k++) {
+		if ((int) k < pop.getSize()) {
+			immigrants[k]->calcFitness(true, true);
+			pop.setIndividual(order[pop.getSize() - 1 - k], immigrants[k]);
+		}
+		delete immigrants[k];
+	}
+	if (!immigrants.empty()) {
+		pop.updateBestIndividual();
+	}
+}
+
+void SocketMigration::deliver(const std::string &msg) {
+
+	unsigned d = nextDestination++ % destinations.size();
+
+	// (re)connect if need be; if the peer isn't there, the migrants are lost
+	if (destinationFds[d] < 0) {
+		destinationFds[d] = connectTo(destinations[d], CONNECT_TIMEOUT_MS);
+		if (destinationFds[d] < 0) {
+			return;
+		}
+	}
+	if (!sendMessage(destinationFds[d], msg)) {
+		closeSocket(destinationFds[d]);
+		destinationFds[d] = -1;
+	}
+}
+
+void SocketMigration::ioLoop() {
+
+	while (!stopping) {
+
+		// outgoing
+		std::string *msg;
+		// (once stopping, whatever is left is dropped by the destructor)
+		while (!stopping && outbox.pop(msg)) {
+			deliver(*msg);
+			delete msg;
+		}
+
+		// incoming
+		vector<struct pollfd> fds;
+		if (listenFd >= 0) {
+			struct pollfd pfd = { listenFd, POLLIN, 0 };
+			fds.push_back(pfd);
+		}
+		for (unsigned i = 0; i < clients.size(); i++) {
+			struct pollfd pfd = { clients[i], POLLIN, 0 };
+			fds.push_back(pfd);
+		}
+		if (fds.empty()) {
+			poll(0, 0, 20);
+			continue;
+		}
+		if (poll(&fds[0], fds.size(), 20) <= 0) {
+			continue;
+		}
+
+		// read from the connections we polled
+		unsigned first = (listenFd >= 0) ? 1 : 0;
+		vector<int> alive;
+		for (unsigned i = first; i < fds.size(); i++) {
+			int fd = fds[i].fd;
+			if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+				alive.push_back(fd);
+				continue;
+			}
+
+			std::string in;
+			if (!recvMessage(fd, in)) {
+				closeSocket(fd);
+				continue;
+			}
+			alive.push_back(fd);
+
+			ByteReader r(in);
+			if (r.getU32() != MIGRATION_MAGIC) {
+				continue;
+			}
+			int count = r.getVarint();
+			for (int k = 0; k < count && r.ok(); k++) {
+				GPProgram *migrant = new GPProgram();
+				if (!readProgram(r, *migrant) || !inbox.push(migrant)) {
+					delete migrant;
+				}
+			}
+		}
+
+		// and pick up new ones
+		if (listenFd >= 0 && (fds[0].revents & POLLIN)) {
+			int fd = acceptConnection(listenFd);
+			if (fd >= 0) {
+				alive.push_back(fd);
+			}
+		}
+		clients = alive;
+	}
+}
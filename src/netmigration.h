@@ -0,0 +1,81 @@
+/**
+ * SocketMigration class.
+ *
+ * Migration between gpsr processes (islands spread over processes or
+ * machines). Migrants are sent, in the compact binary encoding of
+ * serialize.h, over TCP or Unix-domain sockets to the processes given with
+ * --send-to, and are received from any process that connects to the
+ * --listen address.
+ *
+ * All socket I/O happens on a background thread, so migration is
+ * asynchronous: send() only queues the migrants and receive() only collects
+ * whatever has arrived, so a slow or missing peer never stalls the
+ * generation loop. Migrants that cannot be delivered are dropped.
+ *
+ */
+
+#ifndef NETMIGRATION_H
+#define NETMIGRATION_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "gppopulation.h"
+#include "spscqueue.h"
+
+class SocketMigration {
+
+	public:
+		/**
+		 * Constructor. Starts listening and starts the I/O thread.
+		 * @param listenAddress where to receive migrants ("" for nowhere)
+		 * @param destinations where to send migrants (in turn, one per send)
+		 */
+		SocketMigration(const std::string &listenAddress, const std::vector<std::string> &destinations);
+
+		/**
+		 * Destructor. Stops the I/O thread and closes the connections.
+		 */
+		~SocketMigration();
+
+		/**
+		 * Queue migrants to be sent to the next destination. Never blocks.
+		 * @param migrants the individuals (copied)
+		 */
+		void send(const std::vector<GPProgram*> &migrants);
+
+		/**
+		 * Collect the migrants that have arrived so far. Never blocks.
+		 * @return the migrants (the caller deletes them)
+		 */
+		std::vector<GPProgram*> receive();
+
+		/**
+		 * Exchange migrants: send copies of the best individuals of a population
+		 * and replace its worst individuals with whatever has arrived. The
+		 * migrants are re-evaluated on this process's training data.
+		 * @param pop the population
+		 * @param count the number of individuals to send
+		 */
+		void exchange(GPPopulation &pop, int count);
+
+	private:
+		void ioLoop();
+		void deliver(const std::string &msg);
+
+		int listenFd;
+		std::vector<std::string> destinations;
+		std::vector<int> destinationFds;
+		unsigned nextDestination;
+		std::vector<int> clients;
+
+		SPSCQueue<std::string*> outbox;
+		SPSCQueue<GPProgram*> inbox;
+
+		std::thread io;
+		std::atomic<bool> stopping;
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <vector>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "perfcounters.h"
+
+using namespace std;
+
+static const char *counterNames[NUM_COUNTERS] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+static const char *phaseNames[NUM_COUNTED_PHASES] = { "operators", "fitness" };
+
+static bool running = false;
+static bool available[NUM_COUNTERS];
+static vector<int> fds[NUM_COUNTERS];	// one per thread counted
+static long long generationCounts[NUM_COUNTED_PHASES][NUM_COUNTERS];
+static long long totalCounts[NUM_COUNTED_PHASES][NUM_COUNTERS];
+static long long totalNodes = 0;
+
+#ifdef __linux__
+
+static int openCounter(int event, pid_t tid) {
+
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	switch (event) {
+		case COUNTER_CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+		case COUNTER_INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+		case COUNTER_L1D_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case COUNTER_LLC_MISSES: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+		case COUNTER_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+	}
+	// the threads (and processes) started from this one are counted too
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// for scaling when the events have to share the hardware
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+/*
+ * The ids of the threads of this process, the calling thread's first.
+ */
+static vector<pid_t> threadIds() {
+	vector<pid_t> ret;
+	ret.push_back(syscall(SYS_gettid));
+	DIR *dir = opendir("/proc/self/task");
+	if (dir != 0) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != 0) {
+			pid_t tid = atoi(entry->d_name);
+			if (tid > 0 && tid != ret[0]) {
+				ret.push_back(tid);
+			}
+		}
+		closedir(dir);
+	}
+	return ret;
+}
+
+bool startPerfCounters(std::string &error) {
+
+	vector<pid_t> tids = threadIds();
+	running = false;
+	error = "";
+	for (int e = 0; e < NUM_COUNTERS; e++) {
+		int fd = openCounter(e, tids[0]);
+		available[e] = fd >= 0;
+		if (fd < 0) {
+			if (error == "") {
+				error = strerror(errno);
+				if (errno == EACCES || errno == EPERM) {
+					error += " (see /proc/sys/kernel/perf_event_paranoid)";
+				}
+			}
+			continue;
+		}
+		fds[e].push_back(fd);
+		for (unsigned t = 1; t < tids.size(); t++) {
+			fd = openCounter(e, tids[t]);
+			if (fd >= 0) {
+				fds[e].push_back(fd);
+			}
+		}
+		running = true;
+	}
+	return running;
+}
+
+#else
+
+bool startPerfCounters(std::string &error) {
+	for (int e = 0; e < NUM_COUNTERS; e++) {
+		available[e] = false;
+	}
+	error = "performance counters are only available on Linux";
+	return false;
+}
+
+#endif
+
+void stopPerfCounters() {
+	for (int e = 0; e < NUM_COUNTERS; e++) {
+		for (unsigned i = 0; i < fds[e].size(); i++) {
+			close(fds[e][i]);
+		}
+		fds[e].clear();
+	}
+	running = false;
+}
+
+bool perfCountersRunning() {
+	return running;
+}
+
+/*
+ * The counts so far, over every thread (scaled up if an event was only
+ * counted part of the time).
+ */
+static void readCounters(long long *counts) {
+	for (int e = 0; e < NUM_COUNTERS; e++) {
+		double sum = 0.0;
+		for (unsigned i = 0; i < fds[e].size(); i++) {
+			unsigned long long value[3];	// value, time enabled, time running
+			if (read(fds[e][i], value, sizeof(value)) == (ssize_t) sizeof(value) && value[2] > 0) {
+				sum += (value[2] < value[1]) ? (double) value[0] * value[1] / value[2] : (double) value[0];
+			}
+		}
+		counts[e] = (long long) sum;
+	}
+}
+
+CounterScope::CounterScope(CountedPhase p) {
+	phase = p;
+	if (running) {
+		readCounters(start);
+	}
+}
+
+CounterScope::~CounterScope() {
+	if (running) {
+		long long end[NUM_COUNTERS];
+		readCounters(end);
+		for (int e = 0; e < NUM_COUNTERS; e++) {
+			generationCounts[phase][e] += end[e] - start[e];
+		}
+	}
+}
+
+void startGenerationCounters() {
+	memset(generationCounts, 0, sizeof(generationCounts));
+}
+
+void writePerfHeader(std::ostream &os) {
+	os << "# generation";
+	for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+		for (int e = 0; e < NUM_COUNTERS; e++) {
+			os << "\t" << phaseNames[p] << "_" << counterNames[e];
+		}
+	}
+	os << "\tnodes\n";
+}
+
+void writePerfCounters(std::ostream &os, int generation, long long nodes) {
+	os << generation;
+	for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+		for (int e = 0; e < NUM_COUNTERS; e++) {
+			if (available[e]) {
+				os << "\t" << generationCounts[p][e];
+				totalCounts[p][e] += generationCounts[p][e];
+			}
+			else {
+				os << "\t-";
+			}
+		}
+	}
+	os << "\t" << nodes << "\n";
+	totalNodes += nodes;
+}
+
+void resumePerfCounters(const std::vector<std::string> &lines) {
+	for (unsigned i = 0; i < lines.size(); i++) {
+		const char *p = lines[i].c_str();
+		char *end;
+		strtol(p, &end, 10);	// the generation
+		p = end;
+		for (int c = 0; c < NUM_COUNTED_PHASES * NUM_COUNTERS; c++) {
+			long long count = strtoll(p, &end, 10);
+			if (end == p) {
+				p += strspn(p, "\t-");	// not counted
+			}
+			else {
+				totalCounts[c / NUM_COUNTERS][c % NUM_COUNTERS] += count;
+				p = end;
+			}
+		}
+		totalNodes += strtoll(p, 0, 10);
+	}
+}
+
+void printPerfSummary(std::ostream &os) {
+
+	long long nodes = totalNodes;
+
+	static const char *labels[NUM_COUNTERS] = {
+		"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"
+	};
+
+	os << "Hardware counters (all threads):\n";
+	os << "------------------------------------------\n";
+	os << setw(24) << left << "" << right;
+	for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+		os << setw(20) << phaseNames[p];
+	}
+	os << "\n";
+	for (int e = 0; e < NUM_COUNTERS; e++) {
+		if (!available[e]) {
+			os << setw(24) << left << labels[e] << right << "not available\n";
+			continue;
+		}
+		os << setw(24) << left << labels[e] << right;
+		for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+			os << setw(20) << totalCounts[p][e];
+		}
+		os << "\n";
+		// misses per thousand instructions
+		if (e >= COUNTER_L1D_MISSES && available[COUNTER_INSTRUCTIONS]) {
+			os << setw(24) << left << "  per 1000 instructions" << right;
+			for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+				long long instructions = totalCounts[p][COUNTER_INSTRUCTIONS];
+				os << setw(20) << fixed << setprecision(3) << (instructions > 0 ? 1000.0 * totalCounts[p][e] / instructions : 0.0);
+			}
+			os.unsetf(ios::floatfield);
+			os << "\n";
+		}
+	}
+	if (available[COUNTER_CYCLES] && available[COUNTER_INSTRUCTIONS]) {
+		os << setw(24) << left << "instructions per cycle" << right;
+		for (int p = 0; p < NUM_COUNTED_PHASES; p++) {
+			long long cycles = totalCounts[p][COUNTER_CYCLES];
+			os << setw(20) << fixed << setprecision(3) << (cycles > 0 ? (double) totalCounts[p][COUNTER_INSTRUCTIONS] / cycles : 0.0);
+		}
+		os.unsetf(ios::floatfield);
+		os << "\n";
+	}
+	if (nodes > 0) {
+		for (int e = 0; e < NUM_COUNTERS; e++) {
+			if (available[e] && (e == COUNTER_CYCLES || e == COUNTER_INSTRUCTIONS)) {
+				os << setw(24) << left << string(labels[e]) + " per node" << right << setw(40) << fixed << setprecision(3)
+					<< (double) totalCounts[COUNTED_FITNESS][e] / nodes << "\n";
+				os.unsetf(ios::floatfield);
+			}
+		}
+	}
+	os << "------------------------------------------" << endl;
+}
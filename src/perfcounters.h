@@ -0,0 +1,122 @@
+/** \file perfcounters.h
+ * Hardware performance counters (--perf-log), on Linux.
+ *
+ * Cycles, instructions, L1 data cache misses, last-level cache misses and
+ * branch misses are counted with perf_event_open for every thread of the
+ * process (those running when the counters are started, and any started
+ * later), and read around the two phases of a generation that do the work:
+ * the genetic operators (selection, crossover and mutation, or parallel
+ * breeding) and the fitness evaluation. The counts are logged per
+ * generation and summed up at the end of the run.
+ *
+ * Counters aren't always there: the kernel may not allow them
+ * (/proc/sys/kernel/perf_event_paranoid), the machine (e.g. a virtual one)
+ * may have none, or may not have some events. Events that can't be counted
+ * are logged as "-", and if none can, the run goes on without them.
+ * Like the timers (see timing.h), the counters are compiled out with
+ * -DGPSR_NO_TIMING.
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The events counted.
+ */
+enum CounterEvent {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_L1D_MISSES,
+	COUNTER_LLC_MISSES,
+	COUNTER_BRANCH_MISSES,
+	NUM_COUNTERS
+};
+
+/**
+ * The phases counted.
+ */
+enum CountedPhase {
+	COUNTED_OPERATORS,
+	COUNTED_FITNESS,
+	NUM_COUNTED_PHASES
+};
+
+/**
+ * Start counting, for every thread of the process.
+ * @param error set to why no event can be counted
+ * @return false if none can
+ */
+bool startPerfCounters(std::string &error);
+
+/**
+ * Stop counting.
+ */
+void stopPerfCounters();
+
+/**
+ * Gets whether the counters are running.
+ */
+bool perfCountersRunning();
+
+/**
+ * Counts the scope it lives in towards a phase of the current generation
+ * (if the counters are running).
+ */
+class CounterScope {
+
+	public:
+
+		CounterScope(CountedPhase p);
+		~CounterScope();
+
+	private:
+
+		CountedPhase phase;
+		long long start[NUM_COUNTERS];
+};
+
+/**
+ * Start counting a generation: clears its counts.
+ */
+void startGenerationCounters();
+
+/**
+ * Write the header line of a counter log.
+ */
+void writePerfHeader(std::ostream &os);
+
+/**
+ * Write a generation's line of a counter log (the counts of each phase and
+ * the nodes evaluated, separated by tabs), and add them to the run's totals.
+ * @param os the log
+ * @param generation the generation
+ * @param nodes the nodes evaluated in the generation
+ */
+void writePerfCounters(std::ostream &os, int generation, long long nodes);
+
+/**
+ * Add the lines of a counter log kept from before a checkpoint to the run's
+ * totals, when resuming a run.
+ * @param lines the lines (see reopenLog())
+ */
+void resumePerfCounters(const std::vector<std::string> &lines);
+
+/**
+ * Write a summary of the run's totals: the counts, instructions per cycle
+ * and misses per thousand instructions of each phase, and the counts per
+ * node of the fitness evaluation.
+ * @param os where to write it
+ */
+void printPerfSummary(std::ostream &os);
+
+#ifndef GPSR_NO_TIMING
+#define COUNT_PHASE(phase) CounterScope counterScope(phase)
+#else
+#define COUNT_PHASE(phase)
+#endif
+
+#endif
@@ -8,13 +8,84 @@ RNG::RNG(ulong seed) {
 }
 
 RNG::RNG() {
+	engine = defaultEngine;
+}
+
+RNG::Engine RNG::defaultEngine = RNG::XOSHIRO;
+
+void RNG::setDefaultEngine(Engine e) {
+	defaultEngine = e;
+}
+
+RNG::Engine RNG::getEngine() const {
+	return engine;
+}
+
+RNG::State RNG::getState() const {
+	// (only the engine in use has been initialised)
+	State state;
+	state.engine = engine;
+	state.seed = seed;
+	for (int i = 0; i < 5; i++) {
+		state.x[i] = (engine == MWC) ? x[i] : 0.0;
+	}
+	for (int i = 0; i < 4; i++) {
+		state.s[i] = (engine == XOSHIRO) ? s[i] : 0;
+	}
+	return state;
+}
+
+void RNG::setState(const State &state) {
+	engine = state.engine;
+	seed = state.seed;
+	for (int i = 0; i < 5; i++) {
+		x[i] = state.x[i];
+	}
+	for (int i = 0; i < 4; i++) {
+		s[i] = state.s[i];
+	}
+}
 
+static inline unsigned long long rotl(unsigned long long v, int k) {
+	return (v << k) | (v >> (64 - k));
 }
 
+// xoshiro256** (Blackman & Vigna)
+unsigned long long RNG::next() {
+	unsigned long long result = rotl(s[1] * 5, 7) * 9;
+	unsigned long long t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+// Lemire's nearly divisionless method: an unbiased integer in [0, range),
+// for ranges below 2^32
+unsigned long long RNG::bounded(unsigned long long range) {
+	unsigned long long m = (next() >> 32) * range;
+	unsigned int low = (unsigned int) m;
+	if (low < range) {
+		unsigned int threshold = (unsigned int) (-range) % (unsigned int) range;
+		while (low < threshold) {
+			m = (next() >> 32) * range;
+			low = (unsigned int) m;
+		}
+	}
+	return m >> 32;
+}
 
 // returns a random number between 0 and 1:
 double RNG::Random() {
 
+  if (engine == XOSHIRO) {
+	  // top 53 bits -> [0, 1)
+	  return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
   long double c;
   c = (long double)2111111111.0 * x[3] +
       1492.0 * (x[3] = x[2]) +
@@ -31,6 +102,10 @@ double RNG::Random() {
 // returns integer random number in desired interval:
 ulong RNG::IRandom(int min, int max) {
 	int iinterval = max - min + 1;
+	if (engine == XOSHIRO) {
+		if (iinterval <= 0) return min;
+		return min + (long) bounded(iinterval);
+	}
 	if (iinterval <= 0) return 0x80000000; // error
 	int i = long(iinterval * Random()); // truncate
 	if (i >= iinterval) i = iinterval-1;
@@ -41,6 +116,21 @@ ulong RNG::IRandom(int min, int max) {
 // this function initializes the random number generator:
 void RNG::RandomInit (ulong seed) {
 	this->seed = seed;
+	this->engine = defaultEngine;
+
+	if (engine == XOSHIRO) {
+		// expand the seed with SplitMix64, as recommended for xoshiro
+		unsigned long long z = seed;
+		for (int i=0; i<4; i++) {
+			z += 0x9e3779b97f4a7c15ULL;
+			unsigned long long r = z;
+			r = (r ^ (r >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			r = (r ^ (r >> 27)) * 0x94d049bb133111ebULL;
+			s[i] = r ^ (r >> 31);
+		}
+		return;
+	}
+
 	int i;
 	unsigned long s = seed;
 	// make random numbers and put them into the buffer
@@ -82,3 +172,49 @@ int RNG::intRandom(int low, int high) {
 	return IRandom(low, high);
 }
 
+void RNG::fillUniform(double *buf, int n) {
+	if (engine == XOSHIRO) {
+		for (int i=0; i<n; i++) {
+			buf[i] = (next() >> 11) * (1.0 / 9007199254740992.0);
+		}
+	}
+	else {
+		for (int i=0; i<n; i++) {
+			buf[i] = Random();
+		}
+	}
+}
+
+void RNG::fillIntRandom(int *buf, int n, int low, int high) {
+	int iinterval = high - low + 1;
+	if (engine == XOSHIRO && iinterval > 0) {
+		for (int i=0; i<n; i++) {
+			buf[i] = low + (int) bounded(iinterval);
+		}
+	}
+	else {
+		for (int i=0; i<n; i++) {
+			buf[i] = IRandom(low, high);
+		}
+	}
+}
+
+
+// SplitMix64 finaliser
+static unsigned long long mix64(unsigned long long z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+ulong RNG::streamSeed(ulong seed, ulong stream, ulong substream) {
+	unsigned long long z = mix64(seed + 0x9e3779b97f4a7c15ULL);
+	z = mix64(z ^ (stream + 0x9e3779b97f4a7c15ULL));
+	z = mix64(z ^ (substream + 0x9e3779b97f4a7c15ULL));
+	if (defaultEngine == MWC) {
+		// keep to 32 bits, like the seeds the generator was designed for
+		return (ulong) (z >> 32);
+	}
+	// xoshiro expands the whole 64-bit seed
+	return (ulong) z;
+}
@@ -9,6 +9,22 @@ typedef unsigned long ulong;
 
 class RNG {             // encapsulate random number generator
 	public:
+		// the underlying generators
+		enum Engine {
+			MWC,		// the original multiply-with-carry generator (old seeds reproduce)
+			XOSHIRO		// xoshiro256** (the default: faster, 64-bit)
+		};
+
+		/**
+		 * Everything a generator's stream depends on (see getState()).
+		 */
+		struct State {
+			Engine engine;
+			ulong seed;
+			double x[5];
+			unsigned long long s[4];
+		};
+
 		RNG();
 		RNG(ulong seed);   // constructor
 		void RandomInit(ulong seed);      // initialization
@@ -21,8 +37,56 @@ class RNG {             // encapsulate random number generator
 		double dblRandom(double low, double high);
 		int intRandom(int low, int high);
 
+		/**
+		 * Fill a buffer with uniform random numbers between 0 and 1 (the same
+		 * numbers that n calls to uniform() would return).
+		 */
+		void fillUniform(double *buf, int n);
+
+		/**
+		 * Fill a buffer with random integers between low and high (inclusive),
+		 * the same numbers that n calls to intRandom() would return.
+		 */
+		void fillIntRandom(int *buf, int n, int low, int high);
+
+		/**
+		 * Gets the engine of this generator.
+		 */
+		Engine getEngine() const;
+
+		/**
+		 * Gets the state of this generator, e.g. for a checkpoint: a
+		 * generator given the state with setState() carries on with
+		 * exactly the same numbers.
+		 */
+		State getState() const;
+
+		/**
+		 * Sets the state of this generator (as returned by getState()).
+		 */
+		void setState(const State &state);
+
+		/**
+		 * Sets the engine used by generators (re)seeded from now on.
+		 */
+		static void setDefaultEngine(Engine e);
+
+		/**
+		 * Derive the seed of an independent random stream, e.g. one per
+		 * (seed, generation, offspring slot). The seed has 64 bits for
+		 * XOSHIRO and 32 bits for MWC (see setDefaultEngine()).
+		 */
+		static ulong streamSeed(ulong seed, ulong stream, ulong substream);
+
 	protected:
-		double x[5];                         // history buffer
+		unsigned long long next();           // next raw 64-bit output (XOSHIRO)
+		unsigned long long bounded(unsigned long long range);   // unbiased integer in [0, range) (XOSHIRO)
+
+		double x[5];                         // history buffer (MWC)
+		unsigned long long s[4];             // state (XOSHIRO)
 		ulong seed;
+		Engine engine;
+
+		static Engine defaultEngine;
 };
-#endif  
+#endif
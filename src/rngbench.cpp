@@ -0,0 +1,79 @@
+/*
+ * Microbenchmark for the random number generators: single draws (uniform,
+ * bounded integers, coin flips, as used by initialise and growSubtree) and
+ * the bulk API, for both engines.
+ */
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+#include "rng.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static volatile double sink;
+
+static void report(const char *engine, const char *what, long n, Clock::time_point start) {
+	double secs = chrono::duration<double>(Clock::now() - start).count();
+	cout << engine << "\t" << what << "\t" << (n / secs) / 1e6 << " M/s\t" << (secs * 1e9 / n) << " ns/op" << endl;
+}
+
+static void bench(RNG::Engine e, const char *name, long n) {
+
+	RNG::setDefaultEngine(e);
+	RNG r(42);
+	double acc = 0.0;
+	Clock::time_point start;
+
+	start = Clock::now();
+	for (long i = 0; i < n; i++) {
+		acc += r.uniform();
+	}
+	report(name, "uniform", n, start);
+
+	start = Clock::now();
+	for (long i = 0; i < n; i++) {
+		acc += r.intRandom(0, 19);
+	}
+	report(name, "intRandom(0,19)", n, start);
+
+	start = Clock::now();
+	for (long i = 0; i < n; i++) {
+		acc += r.flip(0.5);
+	}
+	report(name, "flip(0.5)", n, start);
+
+	const int bufsize = 4096;
+	vector<double> dbuf(bufsize);
+	vector<int> ibuf(bufsize);
+
+	start = Clock::now();
+	for (long i = 0; i < n; i += bufsize) {
+		r.fillUniform(&dbuf[0], bufsize);
+		acc += dbuf[0];
+	}
+	report(name, "fillUniform", n, start);
+
+	start = Clock::now();
+	for (long i = 0; i < n; i += bufsize) {
+		r.fillIntRandom(&ibuf[0], bufsize, 0, 19);
+		acc += ibuf[0];
+	}
+	report(name, "fillIntRandom(0,19)", n, start);
+
+	sink = acc;
+}
+
+int main(int argc, char* argv[]) {
+
+	long n = (argc > 1) ? atol(argv[1]) : 20000000;
+
+	cout << "engine\tbenchmark\tthroughput\tlatency" << endl;
+	bench(RNG::MWC, "mwc", n);
+	bench(RNG::XOSHIRO, "xoshiro", n);
+
+	return EXIT_SUCCESS;
+}
@@ -3,15 +3,316 @@
 #include <string>
 #include <cstdlib>
 #include <ctime>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
 
 #include "global.h"
 #include "gppopulation.h"
 #include "gpoperators.h"
 #include "usefulfunctions.h"
 #include "rng.h"
+#include "serialize.h"
+#include "dataio.h"
+#include "genlog.h"
+#include "checkpoint.h"
+#include "model.h"
+#include "scorer.h"
 
 using namespace std;
 
+static int failures = 0;
+
+static void check(bool ok, const string &what) {
+	cout << (ok ? "ok:     " : "FAILED: ") << what << endl;
+	if (!ok) {
+		failures++;
+	}
+}
+
+/*
+ * An individual encoded and decoded again is the same individual.
+ */
+static void testSerialize() {
+	for (int i = 0; i < 20; i++) {
+		GPProgram prog(config->genomeSize, 6);
+		prog.calcFitness(true);
+		ByteWriter w;
+		writeProgram(w, prog);
+
+		GPProgram copy;
+		ByteReader r(w.data());
+		bool ok = readProgram(r, copy) && r.atEnd();
+		ByteWriter again;
+		writeProgram(again, copy);
+		ok = ok && again.data() == w.data() && copy.printPostfix() == prog.printPostfix() && copy.getFitness() == prog.getFitness()
+			&& copy.getLSCoeffA() == prog.getLSCoeffA() && copy.getLSCoeffB() == prog.getLSCoeffB();
+		if (!ok) {
+			check(false, "serialize round trip of " + prog.printPostfix());
+			return;
+		}
+	}
+	check(true, "serialize round trip");
+
+	// constant indexes that don't fit (or are negative) are refused
+	ByteWriter w;
+	w.putVarint(1);
+	w.putDouble(0.0);
+	w.putDouble(0.0);
+	w.putDouble(1.0);
+	w.putU8(OP_CONSTANT);
+	w.putVarint(0xffffffffULL);
+	w.putVarint(1);
+	w.putVarint(0xffffffffULL);
+	w.putDouble(1.0);
+	GPProgram prog;
+	ByteReader r(w.data());
+	int local = localConstant(-5, 1.0);
+	check(!readProgram(r, prog) && local >= 0 && local < (int) constants.size(), "serialize refuses bad constant indexes");
+}
+
+/*
+ * Whether parseNumber reads text as strtod does (to the bit).
+ */
+static bool parsesAsStrtod(const string &text) {
+	const char *p = text.c_str();
+	double value;
+	bool parsed = parseNumber(p, text.c_str() + text.size(), value);
+	char *end;
+	double expected = strtod(text.c_str(), &end);
+	if (!parsed || p != end) {
+		return !parsed && end == text.c_str();
+	}
+	return (std::isnan(value) && std::isnan(expected)) || memcmp(&value, &expected, sizeof(value)) == 0;
+}
+
+static void testParseNumber() {
+	const char *cases[] = {
+		"0", "-0", "1", "-1.5", "3.14159", "1e10", "1E-10", ".5", "5.", "+2", "  7", "\t-8",
+		"1.7976931348623157e308", "2.2250738585072014e-308", "4.9406564584124654e-324", "1e309", "1e-400",
+		"9007199254740993", "0.1", "123456789012345678901234567890", "0.000000000000000000000000000001",
+		"2.47032822920623272e-324", "inf", "-inf", "nan", "abc", "-", "."
+	};
+	for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!parsesAsStrtod(cases[i])) {
+			check(false, string("parseNumber of \"") + cases[i] + "\"");
+			return;
+		}
+	}
+	const char *formats[] = { "%.17g", "%g", "%.3e", "%.20f" };
+	for (int i = 0; i < 100000; i++) {
+		double v = (rng.uniform() - 0.5) * pow(10.0, (int) (rng.uniform() * 60) - 30);
+		char text[512];
+		snprintf(text, sizeof(text), formats[i % 4], v);
+		if (!parsesAsStrtod(text)) {
+			check(false, string("parseNumber of \"") + text + "\"");
+			return;
+		}
+	}
+	check(true, "parseNumber gives what strtod does");
+}
+
+/*
+ * A temporary file name for a check.
+ */
+static string tempFile(const string &what) {
+	return "/tmp/runtests-" + to_string(getpid()) + "-" + what;
+}
+
+static bool sameColumn(const DataColumn &a, const DataColumn &b) {
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+/*
+ * The training data written in the binary format reads back the same, and
+ * so does it written as text.
+ */
+static void testBinaryDataset() {
+	string binary = tempFile("data.bin");
+	string text = tempFile("data.txt");
+	vector<DataColumn> vars;
+	DataColumn targs;
+	bool hasHeader;
+
+	bool ok = writeBinaryDataset(binary, variables, targets) && readDataset(binary, vars, targs, hasHeader) == 0;
+	ok = ok && vars.size() == variables.size() && sameColumn(targs, targets);
+	for (unsigned j = 0; ok && j < vars.size(); j++) {
+		ok = sameColumn(vars[j], variables[j]);
+	}
+	check(ok, "binary dataset round trip");
+
+	ok = writeTextDataset(text, variables, targets) && readDataset(text, vars, targs, hasHeader) == 0;
+	ok = ok && vars.size() == variables.size() && sameColumn(targs, targets);
+	for (unsigned j = 0; ok && j < vars.size(); j++) {
+		ok = sameColumn(vars[j], variables[j]);
+	}
+	check(ok, "text dataset round trip");
+
+	unlink(binary.c_str());
+	unlink(text.c_str());
+}
+
+/*
+ * A binary results log, printed by printBinaryLog, is the text log of the
+ * same results (with enough records to fill the log's buffer a few times).
+ */
+static void testBinaryLog() {
+	string text = tempFile("log.txt");
+	string binary = tempFile("log.bin");
+	bool wasBinary = binary_log;
+	{
+		binary_log = false;
+		GenerationLog textLog(text);
+		binary_log = true;
+		GenerationLog binaryLog(binary);
+		for (int i = 0; i < 10000; i++) {
+			GenerationResult result;
+			result.trainPerf = rng.uniform() * pow(10.0, (int) (rng.uniform() * 20) - 10);
+			result.testPerf = rng.uniform() * 1000.0;
+			result.trainHits = rng.uniform() * targets.size();
+			result.testHits = rng.uniform() * test_targets.size();
+			textLog.write(i, result);
+			binaryLog.write(i, result);
+		}
+	}
+	binary_log = wasBinary;
+
+	ifstream in(text.c_str());
+	stringstream expected, printed;
+	expected << in.rdbuf();
+	bool ok = printBinaryLog(binary, printed) && printed.str() == expected.str() && expected.str().size() > 0;
+	check(ok, "binary log prints as the text log");
+
+	unlink(text.c_str());
+	unlink(binary.c_str());
+}
+
+static string encoded(GPPopulation &pop) {
+	ByteWriter w;
+	for (int i = 0; i < pop.getSize(); i++) {
+		writeProgram(w, *(pop.getIndividual(i)));
+	}
+	return w.data();
+}
+
+static bool sameState(const RNG::State &a, const RNG::State &b) {
+	return a.engine == b.engine && a.seed == b.seed && memcmp(a.x, b.x, sizeof(a.x)) == 0 && memcmp(a.s, b.s, sizeof(a.s)) == 0;
+}
+
+/*
+ * A checkpoint reads back as the population, random number generator and
+ * constants it was taken of.
+ */
+static void testCheckpoint() {
+	string file = tempFile("checkpoint");
+	GPPopulation pop(config->popsize, config->genomeSize);
+	pop.calculatePopulationFitness();
+	vector<double> savedConstants = constants;
+	RNG::State state = rng.getState();
+	{
+		CheckpointWriter writer(file);
+		writer.save(pop, 17);
+	}
+
+	// move everything on, for the checkpoint to put back
+	rng.uniform();
+	for (unsigned i = 0; i < constants.size(); i++) {
+		constants[i] += 1.0;
+	}
+	GPPopulation resumed(0);
+	int generation;
+	bool ok = readCheckpoint(file, resumed, generation);
+	ok = ok && generation == 17 && resumed.getSize() == pop.getSize() && resumed.getIndexOfBest() == pop.getIndexOfBest()
+		&& encoded(resumed) == encoded(pop) && sameState(rng.getState(), state) && constants == savedConstants;
+	check(ok, "checkpoint round trip");
+
+	constants = savedConstants;
+	unlink(file.c_str());
+}
+
+static string encoded(const GPProgram &prog) {
+	ByteWriter w;
+	writeProgram(w, prog);
+	return w.data();
+}
+
+/*
+ * Models written with writeModel read back with readModel as the same
+ * individuals, one after another from the same stream.
+ */
+static void testModel() {
+	vector<GPProgram*> progs;
+	stringstream file;
+	for (int i = 0; i < 20; i++) {
+		progs.push_back(new GPProgram(config->genomeSize, 6));
+		progs.back()->calcFitness(true, true);
+		writeModel(file, *progs.back());
+	}
+
+	bool ok = true;
+	string error;
+	for (unsigned i = 0; i < progs.size() && ok; i++) {
+		GPProgram prog;
+		ok = readModel(file, prog, error) && encoded(prog) == encoded(*progs[i]);
+	}
+	GPProgram extra;
+	ok = ok && !readModel(file, extra, error) && error == "";
+	check(ok, "model round trip" + (error != "" ? " (" + error + ")" : ""));
+
+	for (unsigned i = 0; i < progs.size(); i++) {
+		delete progs[i];
+	}
+}
+
+static bool sameValue(double a, double b) {
+	return (std::isnan(a) && std::isnan(b)) || memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/*
+ * A compiled model (of an individual, and of it saved as a model) predicts
+ * the training data exactly as GPProgram::evaluate does with the LS
+ * coefficients applied.
+ */
+static void testCompiledModel() {
+	long cases = targets.size();
+	vector<const double*> columns;
+	for (unsigned j = 0; j < variables.size(); j++) {
+		columns.push_back(variables[j].data());
+	}
+	vector<double> out(cases), saved(cases);
+
+	bool ok = true;
+	for (int i = 0; i < 20 && ok; i++) {
+		GPProgram prog(config->genomeSize, 6);
+		prog.calcFitness(true, true);
+		ResultType values = prog.evaluate(true);
+
+		CompiledModel compiled(prog);
+		compiled.predict(columns, 0, cases, out.data());
+
+		stringstream file;
+		writeModel(file, prog);
+		SavedModel model;
+		string error;
+		ok = readSavedModel(file, model, error);
+		CompiledModel fromSaved(model);
+		fromSaved.predict(columns, 0, cases, saved.data());
+
+		ok = ok && compiled.ok() && fromSaved.ok();
+		for (long k = 0; k < cases && ok; k++) {
+			double expected = prog.getLSCoeffA() + prog.getLSCoeffB() * values[k];
+			ok = sameValue(out[k], expected) && sameValue(saved[k], expected);
+		}
+		if (!ok) {
+			check(false, "compiled model of " + prog.printPostfix());
+			return;
+		}
+	}
+	check(true, "compiled models predict as evaluate");
+}
+
 int main( int argc, char* argv[] ) {
 
 	setupGlobals(argc, argv);
@@ -20,7 +321,7 @@ int main( int argc, char* argv[] ) {
 
 
 	cout << "MAXDEPTH = " << MAXDEPTH << endl;
-	cout << "genomeSize = " << genomeSize << endl;
+	cout << "genomeSize = " << config->genomeSize << endl;
 
 	if (!seed_specified) {
 		seed = time(0) ^ (getpid() << 16);
@@ -60,7 +361,16 @@ int main( int argc, char* argv[] ) {
 
 	
 	delete prog1;
+
+	testSerialize();
+	testParseNumber();
+	testBinaryDataset();
+	testBinaryLog();
+	testCheckpoint();
+	testModel();
+	testCompiledModel();
+
 	cleanup();
 
-	return EXIT_SUCCESS;
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "model.h"
+#include "scorer.h"
+
+using namespace std;
+
+static void usage(const char *arg) {
+	cerr << "usage: " << arg << " [options] modelfile datafile [predictionsfile]" << endl;
+	cerr << "  modelfile: a model saved by gpsr (<best file>.model)" << endl;
+	cerr << "  datafile:  the cases to score, text or binary (as for gpsr -d)" << endl;
+	cerr << "  predictionsfile: where to write the predictions, one per line (default: standard output)" << endl;
+	cerr << "options:" << endl;
+	cerr << "  -T num    threads (default: 1)" << endl;
+	cerr << "  -m num    score the num'th model of the file (default: 1)" << endl;
+	cerr << "  -n        the data has no target column (the last column is a variable)" << endl;
+	cerr << "  -b        write the predictions as little-endian doubles" << endl;
+	cerr << "  -C num    cases read at a time (default: 1048576)" << endl;
+}
+
+/*
+ * gpsr-score: predict the values of new cases with a saved model.
+ */
+int main( int argc, char* argv[] ) {
+
+	int which = 1;
+	bool hasTargets = true;
+	bool binary = false;
+	long chunkCases = 1 << 20;
+	int c;
+	while ((c = getopt(argc, argv, "T:m:nbC:h")) != -1) {
+		switch (c) {
+			case 'T': numThreads = atoi(optarg); break;
+			case 'm': which = atoi(optarg); break;
+			case 'n': hasTargets = false; break;
+			case 'b': binary = true; break;
+			case 'C': chunkCases = atol(optarg); break;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind < 2 || argc - optind > 3 || which < 1 || chunkCases < 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	string modelFile = argv[optind];
+	string dataFile = argv[optind + 1];
+
+	ifstream in(modelFile.c_str());
+	if (!in) {
+		cerr << "Could not open model file " << modelFile << endl;
+		return EXIT_FAILURE;
+	}
+	SavedModel saved;
+	string error;
+	for (int i = 0; i < which; i++) {
+		if (!readSavedModel(in, saved, error)) {
+			cerr << "Could not read model " << which << " of " << modelFile << (error != "" ? ": " + error : "") << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	CompiledModel model(saved);
+	if (!model.ok()) {
+		cerr << "Model " << which << " of " << modelFile << " is not a whole expression" << endl;
+		return EXIT_FAILURE;
+	}
+
+	int fd = 1;
+	if (argc - optind == 3) {
+		fd = open(argv[optind + 2], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if (fd < 0) {
+			cerr << "Could not open " << argv[optind + 2] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	ScoreSummary summary;
+	long bad = scoreDataset(model, dataFile, hasTargets, chunkCases, fd, binary, summary);
+	if (fd != 1 && close(fd) < 0) {
+		bad = -1;
+	}
+	if (bad < 0) {
+		cerr << "Could not score " << dataFile << endl;
+		return EXIT_FAILURE;
+	}
+	if (bad > 0) {
+		cerr << "Something went wrong reading in " << dataFile << endl;
+		cerr << "at line " << bad << endl;
+		return EXIT_FAILURE;
+	}
+
+	cerr << summary.cases << " cases in " << summary.seconds << " s (" << summary.cases / summary.seconds << " per second)";
+	if (hasTargets && summary.cases > 0) {
+		cerr << ", MSE " << summary.sse / summary.cases;
+	}
+	cerr << endl;
+	return EXIT_SUCCESS;
+}
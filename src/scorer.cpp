@@ -0,0 +1,303 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+#include "scorer.h"
+#include "serialize.h"
+#include "dataio.h"
+#include "threadpool.h"
+#include "global.h"
+
+using namespace std;
+
+//
+// CompiledModel
+//
+
+CompiledModel::CompiledModel(const SavedModel &model) {
+
+	vector<double> values(model.ops.size(), 0.0);
+	valid = true;
+	for (unsigned i = 0; i < model.ops.size(); i++) {
+		if (model.ops[i] == OP_CONSTANT) {
+			map<int, double>::const_iterator it = model.constants.find(model.data[i]);
+			if (it == model.constants.end()) {
+				valid = false;
+			}
+			else {
+				values[i] = it->second;
+			}
+		}
+	}
+	lsCoeffA = model.lsCoeffA;
+	lsCoeffB = model.lsCoeffB;
+	compile(model.ops, model.data, values);
+}
+
+CompiledModel::CompiledModel(const GPProgram &prog) {
+
+	vector<unsigned char> ops(prog.getSize());
+	vector<int> data(prog.getSize());
+	vector<double> values(prog.getSize(), 0.0);
+	valid = true;
+	for (int i = 0; i < prog.getSize(); i++) {
+		GPNode *node = prog.getNode(i);
+		ops[i] = typeToOpcode(node->getType());
+		data[i] = node->getData();
+		if (ops[i] == OP_CONSTANT) {
+			values[i] = constants[data[i]];
+		}
+	}
+	lsCoeffA = prog.getLSCoeffA();
+	lsCoeffB = prog.getLSCoeffB();
+	compile(ops, data, values);
+}
+
+void CompiledModel::compile(const std::vector<unsigned char> &ops, const std::vector<int> &data, const std::vector<double> &values) {
+
+	code.resize(ops.size());
+	maxDepth = 0;
+	numVariables = 0;
+	int depth = 0;
+	for (unsigned i = 0; i < ops.size(); i++) {
+		code[i].op = ops[i];
+		code[i].var = data[i];
+		code[i].value = values[i];
+		switch (ops[i]) {
+			case OP_VAR:
+				numVariables = max(numVariables, data[i] + 1);
+				depth++;
+				break;
+			case OP_CONSTANT:
+				depth++;
+				break;
+			case OP_ADD: case OP_MIN: case OP_MUL: case OP_DIV:
+				depth--;
+				break;
+			case OP_SQR: case OP_COS: case OP_SIN: case OP_LOG:
+				break;
+			default:
+				valid = false;
+		}
+		if (depth <= 0) {
+			valid = false;
+		}
+		maxDepth = max(maxDepth, depth);
+	}
+	if (depth != 1) {
+		valid = false;
+	}
+}
+
+bool CompiledModel::ok() const {
+	return valid;
+}
+
+int CompiledModel::getNumVariables() const {
+	return numVariables;
+}
+
+void CompiledModel::predict(const std::vector<const double*> &columns, long begin, long end, double *out) const {
+
+	// the stack: the values in blocks of their own (a variable's block is
+	// read where it lies instead)
+	static thread_local vector<double> blocks;
+	static thread_local vector<const double*> stack;
+	blocks.resize((size_t) maxDepth * SCORE_BLOCK);
+	stack.resize(maxDepth);
+
+	for (long first = begin; first < end; first += SCORE_BLOCK) {
+		int n = (int) min((long) SCORE_BLOCK, end - first);
+		int sp = 0;
+
+		for (unsigned k = 0; k < code.size(); k++) {
+			const Instruction &in = code[k];
+			if (in.op == OP_VAR) {
+				stack[sp++] = columns[in.var] + first;
+				continue;
+			}
+			if (in.op == OP_CONSTANT) {
+				double *r = &blocks[(size_t) sp * SCORE_BLOCK];
+				for (int i = 0; i < n; i++) {
+					r[i] = in.value;
+				}
+				stack[sp++] = r;
+				continue;
+			}
+
+			// the result goes in the block of the first operand's place
+			bool binaryOp = in.op <= OP_DIV;
+			double *r = &blocks[(size_t) (binaryOp ? sp - 2 : sp - 1) * SCORE_BLOCK];
+			const double *x = binaryOp ? stack[sp - 2] : 0;
+			const double *y = stack[sp - 1];
+			switch (in.op) {
+				case OP_ADD:
+					for (int i = 0; i < n; i++) {
+						r[i] = x[i] + y[i];
+					}
+					break;
+				case OP_MIN:
+					for (int i = 0; i < n; i++) {
+						r[i] = x[i] - y[i];
+					}
+					break;
+				case OP_MUL:
+					for (int i = 0; i < n; i++) {
+						r[i] = x[i] * y[i];
+					}
+					break;
+				case OP_DIV:
+					// protected, as protectedDivision()
+					for (int i = 0; i < n; i++) {
+						r[i] = (y[i] == 0.0) ? 0.0 : x[i] / y[i];
+					}
+					break;
+				case OP_SQR:
+					for (int i = 0; i < n; i++) {
+						r[i] = y[i] * y[i];
+					}
+					break;
+				case OP_COS:
+					for (int i = 0; i < n; i++) {
+						r[i] = cos(y[i]);
+					}
+					break;
+				case OP_SIN:
+					for (int i = 0; i < n; i++) {
+						r[i] = sin(y[i]);
+					}
+					break;
+				case OP_LOG:
+					// protected, as protectedLog()
+					for (int i = 0; i < n; i++) {
+						r[i] = (y[i] <= 0.0) ? 0.0 : log(y[i]);
+					}
+					break;
+			}
+			if (binaryOp) {
+				sp--;
+			}
+			stack[sp - 1] = r;
+		}
+
+		const double *result = stack[0];
+		double *o = out + (first - begin);
+		for (int i = 0; i < n; i++) {
+			o[i] = lsCoeffA + lsCoeffB * result[i];
+		}
+	}
+}
+
+//
+// scoring a dataset
+//
+
+static bool writeAll(int fd, const char *p, size_t n) {
+	while (n > 0) {
+		ssize_t k = ::write(fd, p, n);
+		if (k < 0 && errno == EINTR) {
+			continue;
+		}
+		if (k <= 0) {
+			return false;
+		}
+		p += k;
+		n -= k;
+	}
+	return true;
+}
+
+long scoreDataset(const CompiledModel &model, const std::string &filename, bool hasTargets, long chunkCases, int fd, bool binary, ScoreSummary &summary) {
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	summary.cases = 0;
+	summary.sse = 0.0;
+	summary.seconds = 0.0;
+
+	DatasetStream stream;
+	bool hasHeader;
+	long bad = stream.open(filename, chunkCases, hasHeader);
+	if (bad != 0) {
+		return bad;
+	}
+	int available = stream.getNumVariables() + (hasTargets ? 0 : 1);
+	if (available < model.getNumVariables()) {
+		cerr << filename << " has " << available << " variables, the model needs " << model.getNumVariables() << endl;
+		return -1;
+	}
+
+	vector<DataColumn> vars;
+	DataColumn trg;
+	vector<double> predictions;
+	vector<string> text;
+	vector<double> sse;
+	for (int c = 0; c < stream.getNumChunks(); c++) {
+		bad = stream.fetch(c, vars, trg);
+		if (bad != 0) {
+			return bad;	// (already counted from the start of the file)
+		}
+		stream.prefetch(c + 1);
+
+		vector<const double*> columns;
+		for (unsigned j = 0; j < vars.size(); j++) {
+			columns.push_back(vars[j].data());
+		}
+		if (!hasTargets) {
+			columns.push_back(trg.data());
+		}
+
+		long ncases = trg.size();
+		int ntasks = (ncases + SCORE_TASK_CASES - 1) / SCORE_TASK_CASES;
+		predictions.resize(ncases);
+		text.resize(ntasks);
+		sse.assign(ntasks, 0.0);
+		workerPool().run(ntasks, [&](int t) {
+			long begin = (long) t * SCORE_TASK_CASES;
+			long end = min(ncases, begin + SCORE_TASK_CASES);
+			model.predict(columns, begin, end, &predictions[begin]);
+			if (hasTargets) {
+				for (long i = begin; i < end; i++) {
+					double err = predictions[i] - trg[i];
+					sse[t] += err * err;
+				}
+			}
+			if (!binary) {
+				// formatted by the tasks too, as it costs more than the scoring
+				string &s = text[t];
+				s.resize((end - begin) * 32);
+				size_t used = 0;
+				char line[32];
+				for (long i = begin; i < end; i++) {
+					int k = snprintf(line, sizeof(line), "%.17g\n", predictions[i]);
+					memcpy(&s[used], line, k);
+					used += k;
+				}
+				s.resize(used);
+			}
+		});
+
+		bool written = true;
+		if (binary) {
+			written = writeAll(fd, (const char*) predictions.data(), ncases * sizeof(double));
+		}
+		for (int t = 0; t < ntasks; t++) {
+			summary.sse += sse[t];
+			if (!binary) {
+				written = written && writeAll(fd, text[t].data(), text[t].size());
+			}
+		}
+		if (!written) {
+			cerr << "Could not write the predictions" << endl;
+			return -1;
+		}
+		summary.cases += ncases;
+	}
+
+	summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return 0;
+}
@@ -0,0 +1,109 @@
+/** \file scorer.h
+ * Scoring models on new data (gpsr-score).
+ *
+ * A CompiledModel is a model's genome turned into a flat list of
+ * instructions, evaluated SCORE_BLOCK fitness cases at a time: each value
+ * on the evaluation stack is a block of SCORE_BLOCK doubles, so the whole
+ * stack stays in the cache, and each instruction is a simple loop over a
+ * block that the compiler vectorises. Variables are read where they lie.
+ * The predictions are exactly those of GPProgram::evaluate, with the LS
+ * coefficients applied (a + b * value).
+ *
+ * scoreDataset() streams a dataset (see DatasetStream) through a model on
+ * the worker pool and writes out the predictions.
+ */
+
+#ifndef SCORER_H
+#define SCORER_H
+
+#include <string>
+#include <vector>
+
+#include "model.h"
+#include "gpprogram.h"
+
+/* the fitness cases evaluated at a time */
+#define SCORE_BLOCK 256
+/* the fitness cases a worker task scores */
+#define SCORE_TASK_CASES (64 * SCORE_BLOCK)
+
+class CompiledModel {
+
+	public:
+		/**
+		 * Constructor.
+		 * @param model a saved model (with its own constants)
+		 */
+		explicit CompiledModel(const SavedModel &model);
+
+		/**
+		 * Constructor.
+		 * @param prog an individual of this run (with the run's constants)
+		 */
+		explicit CompiledModel(const GPProgram &prog);
+
+		/**
+		 * @return false if the genome isn't a whole postfix expression, or
+		 * uses a constant the model doesn't give
+		 */
+		bool ok() const;
+
+		/**
+		 * @return the number of variables the model needs (one more than
+		 * the highest it uses)
+		 */
+		int getNumVariables() const;
+
+		/**
+		 * Predict the values of a range of fitness cases.
+		 * @param columns the values of each variable (at least
+		 * getNumVariables() of them)
+		 * @param begin the first fitness case
+		 * @param end one past the last fitness case
+		 * @param out set to the predictions for begin .. end-1
+		 */
+		void predict(const std::vector<const double*> &columns, long begin, long end, double *out) const;
+
+	private:
+		struct Instruction {
+			unsigned char op;	// Opcode (serialize.h)
+			int var;		// OP_VAR: the variable
+			double value;		// OP_CONSTANT: the constant
+		};
+
+		void compile(const std::vector<unsigned char> &ops, const std::vector<int> &data, const std::vector<double> &values);
+
+		std::vector<Instruction> code;
+		bool valid;
+		int maxDepth;
+		int numVariables;
+		double lsCoeffA;
+		double lsCoeffB;
+};
+
+/**
+ * What scoreDataset() did.
+ */
+struct ScoreSummary {
+	long cases;
+	double sse;		// sum of squared errors (if the data has targets)
+	double seconds;
+};
+
+/**
+ * Score a dataset with a model, on the worker pool, a chunk of fitness
+ * cases at a time.
+ * @param model the model
+ * @param filename the dataset (text or binary)
+ * @param hasTargets the last column is the target (else it is a variable)
+ * @param chunkCases the fitness cases read at a time
+ * @param fd where to write the predictions
+ * @param binary write them as little-endian doubles (else one per line)
+ * @param summary set to what was done
+ * @return 0 if all went well, -1 if the data couldn't be opened or doesn't
+ * have the variables the model needs, or the number (from 1) of the first
+ * fitness case that couldn't be read
+ */
+long scoreDataset(const CompiledModel &model, const std::string &filename, bool hasTargets, long chunkCases, int fd, bool binary, ScoreSummary &summary);
+
+#endif
@@ -0,0 +1,321 @@
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <map>
+
+#include "serialize.h"
+#include "global.h"
+
+using namespace std;
+
+Opcode typeToOpcode(const std::string &type) {
+	if (type == "VAR") return OP_VAR;
+	if (type == "constant") return OP_CONSTANT;
+	if (type == "ADD") return OP_ADD;
+	if (type == "MIN") return OP_MIN;
+	if (type == "MUL") return OP_MUL;
+	if (type == "DIV") return OP_DIV;
+	if (type == "SQR") return OP_SQR;
+	if (type == "COS") return OP_COS;
+	if (type == "SIN") return OP_SIN;
+	if (type == "LOG") return OP_LOG;
+	return OP_INVALID;
+}
+
+//
+// ByteWriter
+//
+
+void ByteWriter::putU8(unsigned char v) {
+	buf.push_back((char) v);
+}
+
+void ByteWriter::putU32(unsigned int v) {
+	for (int i = 0; i < 4; i++) {
+		buf.push_back((char) ((v >> (8 * i)) & 0xff));
+	}
+}
+
+void ByteWriter::putU64(unsigned long long v) {
+	for (int i = 0; i < 8; i++) {
+		buf.push_back((char) ((v >> (8 * i)) & 0xff));
+	}
+}
+
+void ByteWriter::putVarint(unsigned long long v) {
+	while (v >= 0x80) {
+		buf.push_back((char) ((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
+	buf.push_back((char) v);
+}
+
+void ByteWriter::putDouble(double v) {
+	unsigned long long bits;
+	memcpy(&bits, &v, sizeof(bits));
+	putU64(bits);
+}
+
+void ByteWriter::putString(const std::string &s) {
+	putVarint(s.size());
+	buf.append(s);
+}
+
+void ByteWriter::putBytes(const char *p, size_t n) {
+	buf.append(p, n);
+}
+
+const std::string& ByteWriter::data() const {
+	return buf;
+}
+
+void ByteWriter::clear() {
+	buf.clear();
+}
+
+//
+// ByteReader
+//
+
+ByteReader::ByteReader(const char *data, size_t size) {
+	p = data;
+	end = data + size;
+	good = true;
+}
+
+ByteReader::ByteReader(const std::string &data) {
+	p = data.data();
+	end = p + data.size();
+	good = true;
+}
+
+unsigned char ByteReader::getU8() {
+	if (p >= end) {
+		good = false;
+		return 0;
+	}
+	return (unsigned char) *p++;
+}
+
+unsigned int ByteReader::getU32() {
+	unsigned int v = 0;
+	for (int i = 0; i < 4; i++) {
+		v |= (unsigned int) getU8() << (8 * i);
+	}
+	return v;
+}
+
+unsigned long long ByteReader::getU64() {
+	unsigned long long v = 0;
+	for (int i = 0; i < 8; i++) {
+		v |= (unsigned long long) getU8() << (8 * i);
+	}
+	return v;
+}
+
+unsigned long long ByteReader::getVarint() {
+	unsigned long long v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char b = getU8();
+		v |= (unsigned long long) (b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return v;
+		}
+	}
+	good = false;
+	return 0;
+}
+
+double ByteReader::getDouble() {
+	unsigned long long bits = getU64();
+	double v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+std::string ByteReader::getString() {
+	unsigned long long n = getVarint();
+	if (n > (unsigned long long) (end - p)) {
+		good = false;
+		return "";
+	}
+	std::string ret(p, n);
+	p += n;
+	return ret;
+}
+
+bool ByteReader::getBytes(char *dest, size_t n) {
+	if (n > (size_t) (end - p)) {
+		good = false;
+		return false;
+	}
+	memcpy(dest, p, n);
+	p += n;
+	return true;
+}
+
+bool ByteReader::ok() const {
+	return good;
+}
+
+bool ByteReader::atEnd() const {
+	return p == end;
+}
+
+size_t ByteReader::remaining() const {
+	return end - p;
+}
+
+//
+// GPProgram encoding
+//
+
+void writeProgram(ByteWriter &w, const GPProgram &prog) {
+
+	w.putVarint(prog.getSize());
+	w.putDouble(prog.getFitness());
+	w.putDouble(prog.getLSCoeffA());
+	w.putDouble(prog.getLSCoeffB());
+
+	map<int, double> used;
+	for (int i = 0; i < prog.getSize(); i++) {
+		GPNode *node = prog.getNode(i);
+		Opcode op = typeToOpcode(node->getType());
+		w.putU8(op);
+		w.putVarint(node->getData());
+		if (op == OP_CONSTANT) {
+			used[node->getData()] = constants[node->getData()];
+		}
+	}
+
+	w.putVarint(used.size());
+	for (map<int, double>::iterator it = used.begin(); it != used.end(); it++) {
+		w.putVarint(it->first);
+		w.putDouble(it->second);
+	}
+}
+
+int localConstant(int index, double value) {
+
+	if (index >= 0 && index < (int) constants.size() && constants[index] == value) {
+		return index;
+	}
+	int nearest = 0;
+	for (unsigned i = 0; i < constants.size(); i++) {
+		if (constants[i] == value) {
+			return i;
+		}
+		if (fabs(constants[i] - value) < fabs(constants[nearest] - value)) {
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+static GPNode* findNode(std::vector<GPNode> &nodes, const std::string &type) {
+	for (unsigned i = 0; i < nodes.size(); i++) {
+		if (nodes[i].getType() == type) {
+			return &(nodes[i]);
+		}
+	}
+	return 0;
+}
+
+bool readProgram(ByteReader &r, GPProgram &prog) {
+
+	// (the data may come from another process, so nothing is taken on trust)
+	unsigned long long size = r.getVarint();
+	double fitness = r.getDouble();
+	double a = r.getDouble();
+	double b = r.getDouble();
+	// every node takes at least two bytes
+	if (!r.ok() || size == 0 || size > r.remaining() / 2) {
+		return false;
+	}
+
+	vector<unsigned char> ops(size);
+	vector<int> data(size);
+	for (unsigned long long i = 0; i < size; i++) {
+		ops[i] = r.getU8();
+		unsigned long long index = r.getVarint();
+		if (index > INT_MAX) {
+			return false;
+		}
+		data[i] = index;
+	}
+
+	map<int, double> used;
+	unsigned long long numUsed = r.getVarint();
+	for (unsigned long long i = 0; i < numUsed && r.ok(); i++) {
+		unsigned long long index = r.getVarint();
+		if (index > INT_MAX) {
+			return false;
+		}
+		used[index] = r.getDouble();
+	}
+	if (!r.ok() || !buildGenome(ops, data, used, prog)) {
+		return false;
+	}
+
+	prog.setFitness(fitness);
+	prog.setLSCoeffA(a);
+	prog.setLSCoeffB(b);
+	return true;
+}
+
+bool buildGenome(const std::vector<unsigned char> &ops, const std::vector<int> &data, const std::map<int, double> &used, GPProgram &prog) {
+
+	static const char *binaryTypes[] = { "ADD", "MIN", "MUL", "DIV" };
+	static const char *unaryTypes[] = { "SQR", "COS", "SIN", "LOG" };
+
+	map<int, int> constantMap;
+	for (map<int, double>::const_iterator it = used.begin(); it != used.end(); it++) {
+		if (constants.empty()) {
+			return false;
+		}
+		constantMap[it->first] = localConstant(it->first, it->second);
+	}
+
+	int size = ops.size();
+	vector<GPNode*> genome;
+	genome.reserve(size);
+	int depth = 0;
+	for (int i = 0; i < size; i++) {
+		GPNode *node = 0;
+		switch (ops[i]) {
+			case OP_VAR:
+				if (data[i] >= 0 && data[i] < (int) t_variables.size()) {
+					node = &(t_variables[data[i]]);
+				}
+				break;
+			case OP_CONSTANT:
+				if (constantMap.count(data[i])) {
+					node = &(t_constants[constantMap[data[i]]]);
+				}
+				break;
+			case OP_ADD: case OP_MIN: case OP_MUL: case OP_DIV:
+				node = findNode(t_binaries, binaryTypes[ops[i] - OP_ADD]);
+				break;
+			case OP_SQR: case OP_COS: case OP_SIN: case OP_LOG:
+				node = findNode(t_unaries, unaryTypes[ops[i] - OP_SQR]);
+				break;
+		}
+		if (node == 0) {
+			return false;
+		}
+
+		// make sure the postfix genome maps okay onto the stack
+		depth -= node->getArity();
+		if (depth <= 0) {
+			return false;
+		}
+		genome.push_back(node);
+	}
+	if (size == 0 || depth != 1) {
+		return false;
+	}
+
+	prog.setGenome(genome);
+	prog.setSize(size);
+	return true;
+}
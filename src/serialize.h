@@ -0,0 +1,152 @@
+/** \file serialize.h
+ * Compact binary encoding of GP individuals.
+ *
+ * An individual is written as its size, fitness and LS coefficients,
+ * followed by one opcode byte and one data index (a varint) per node of the
+ * postfix genome, and finally the (index, value) pairs of the constants the
+ * genome refers to. All numbers are little-endian, so the encoding can be
+ * moved between processes and machines.
+ *
+ * When an individual is read back, its nodes are mapped onto the node lists
+ * of the reading process (t_variables, t_constants, t_unaries, t_binaries).
+ * Processes started with the same -j/-r settings share the same constants,
+ * so a constant normally maps onto the same index; otherwise it is mapped
+ * onto the constant with the same value or, failing that, the nearest one.
+ */
+
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "gpprogram.h"
+
+/**
+ * Node opcodes of the wire format.
+ */
+enum Opcode {
+	OP_VAR = 0,
+	OP_CONSTANT,
+	OP_ADD,
+	OP_MIN,
+	OP_MUL,
+	OP_DIV,
+	OP_SQR,
+	OP_COS,
+	OP_SIN,
+	OP_LOG,
+	OP_INVALID
+};
+
+/**
+ * Gets the opcode of a node type.
+ * @param type the node type (as GPNode::getType())
+ * @return the opcode, or OP_INVALID
+ */
+Opcode typeToOpcode(const std::string &type);
+
+/**
+ * Appends little-endian binary values to a buffer.
+ */
+class ByteWriter {
+
+	public:
+		void putU8(unsigned char v);
+		void putU32(unsigned int v);
+		void putU64(unsigned long long v);
+		void putVarint(unsigned long long v);
+		void putDouble(double v);
+		void putString(const std::string &s);
+		void putBytes(const char *p, size_t n);
+
+		/**
+		 * Gets the bytes written so far.
+		 */
+		const std::string& data() const;
+
+		/**
+		 * Forget the bytes written so far.
+		 */
+		void clear();
+
+	private:
+		std::string buf;
+};
+
+/**
+ * Reads little-endian binary values from a buffer. Reading past the end
+ * returns zeros and clears the ok flag.
+ */
+class ByteReader {
+
+	public:
+		ByteReader(const char *data, size_t size);
+		ByteReader(const std::string &data);
+
+		unsigned char getU8();
+		unsigned int getU32();
+		unsigned long long getU64();
+		unsigned long long getVarint();
+		double getDouble();
+		std::string getString();
+		bool getBytes(char *p, size_t n);
+
+		/**
+		 * @return false if any read went past the end of the buffer
+		 */
+		bool ok() const;
+
+		/**
+		 * @return true if everything has been read
+		 */
+		bool atEnd() const;
+
+		/**
+		 * @return the number of bytes left to read
+		 */
+		size_t remaining() const;
+
+	private:
+		const char *p;
+		const char *end;
+		bool good;
+};
+
+/**
+ * Encode an individual.
+ * @param w the writer to append to
+ * @param prog the individual
+ */
+void writeProgram(ByteWriter &w, const GPProgram &prog);
+
+/**
+ * Decode an individual written by writeProgram.
+ * @param r the reader
+ * @param prog set to the individual
+ * @return false if the data is corrupt or uses a node this process doesn't have
+ */
+bool readProgram(ByteReader &r, GPProgram &prog);
+
+/**
+ * Build a genome from decoded nodes, mapped onto the node lists of this
+ * process (as readProgram does).
+ * @param ops the opcode of each node of the postfix genome
+ * @param data the data index of each node (variable or constant number)
+ * @param used the constants the genome refers to (index -> value)
+ * @param prog set to the genome
+ * @return false if the nodes don't make a valid genome in this process
+ */
+bool buildGenome(const std::vector<unsigned char> &ops, const std::vector<int> &data, const std::map<int, double> &used, GPProgram &prog);
+
+/**
+ * Gets the constant of this process that stands in for another process's
+ * constant: the same index if it holds the same value, else the constant
+ * with that value or, failing that, the nearest one.
+ * @param index the constant's index in the other process
+ * @param value its value
+ * @return the index of the local constant
+ */
+int localConstant(int index, double value);
+
+#endif
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "shareddata.h"
+#include "dataio.h"
+
+using namespace std;
+
+/*
+ * A mapping of a shared segment, unmapped when the last column viewing it
+ * goes.
+ */
+struct SharedMapping {
+	void *start;
+	size_t length;
+	~SharedMapping() {
+		munmap(start, length);
+	}
+};
+
+/* the segments this process is attached to (each held with a shared lock) */
+struct AttachedSegment {
+	string name;
+	int fd;
+};
+static vector<AttachedSegment> attached;
+
+/*
+ * Whether a segment's name still names the segment open as fd (and not one
+ * made since by another process).
+ */
+static bool namesSegment(const string &name, int fd) {
+	int other = shm_open(name.c_str(), O_RDONLY, 0);
+	if (other < 0) {
+		return false;
+	}
+	struct stat a, b;
+	bool same = fstat(fd, &a) == 0 && fstat(other, &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+	close(other);
+	return same;
+}
+
+static void removeSegment(const string &name, int fd) {
+	if (namesSegment(name, fd)) {
+		shm_unlink(name.c_str());
+	}
+}
+
+/*
+ * Let go of all the segments (at exit); a process that finds nobody else
+ * holding a segment removes it.
+ */
+static void detachAll() {
+	for (unsigned i = 0; i < attached.size(); i++) {
+		if (flock(attached[i].fd, LOCK_EX | LOCK_NB) == 0) {
+			removeSegment(attached[i].name, attached[i].fd);
+		}
+		close(attached[i].fd);
+	}
+	attached.clear();
+}
+
+static void addAttached(const string &name, int fd) {
+	if (attached.empty()) {
+		atexit(detachAll);
+	}
+	AttachedSegment a = { name, fd };
+	attached.push_back(a);
+}
+
+static shared_ptr<SharedMapping> mapSegment(int fd, size_t length, int prot) {
+	void *p = mmap(0, length, prot, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		return shared_ptr<SharedMapping>();
+	}
+	shared_ptr<SharedMapping> m(new SharedMapping());
+	m->start = p;
+	m->length = length;
+	return m;
+}
+
+/*
+ * Whether a segment has been published, so its dataset is whole.
+ */
+static bool isPublished(int fd) {
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(SharedDataControl)) {
+		return false;
+	}
+	shared_ptr<SharedMapping> control = mapSegment(fd, sizeof(SharedDataControl), PROT_READ);
+	return control && ((SharedDataControl*) control->start)->ready == 1;
+}
+
+/*
+ * The columns of a segment's dataset.
+ */
+static void viewColumns(const shared_ptr<SharedMapping> &data, std::vector<DataColumn> &vars, DataColumn &targets) {
+
+	char *segment = (char*) data->start;
+	BinaryDatasetHeader *header = (BinaryDatasetHeader*) (segment + sizeof(SharedDataControl));
+	char *base = (char*) header + header->dataOffset;
+	shared_ptr<void> owner = data;
+	vars.resize(header->columns - 1);
+	for (unsigned j = 0; j < vars.size(); j++) {
+		vars[j].view((double*) (base + j * header->columnBytes), header->rows, owner);
+	}
+	targets.view((double*) (base + vars.size() * header->columnBytes), header->rows, owner);
+}
+
+/*
+ * Read a dataset and publish it in a segment just created (fd), whose
+ * control block is already mapped. Returns as readDataset.
+ */
+static int publish(int fd, const shared_ptr<SharedMapping> &control, const string &filename, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader) {
+
+	SharedDataControl *c = (SharedDataControl*) control->start;
+	int bad = readDataset(filename, vars, targets, hasHeader);
+	if (bad != 0) {
+		c->ready = -1;
+		return bad;
+	}
+
+	BinaryDatasetHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_DATASET_MAGIC, sizeof(header.magic));
+	header.version = BINARY_DATASET_VERSION;
+	header.dtype = BINARY_DATASET_FLOAT64;
+	header.rows = targets.size();
+	header.columns = vars.size() + 1;
+	header.columnBytes = (header.rows * sizeof(double) + BINARY_DATASET_ALIGN - 1) / BINARY_DATASET_ALIGN * BINARY_DATASET_ALIGN;
+	header.dataOffset = sizeof(header);
+	size_t length = sizeof(SharedDataControl) + header.dataOffset + header.columns * header.columnBytes;
+
+	shared_ptr<SharedMapping> data;
+	if (ftruncate(fd, length) < 0 || !(data = mapSegment(fd, length, PROT_READ | PROT_WRITE))) {
+		c->ready = -1;
+		return 0;	// keep the private copy
+	}
+	char *base = (char*) data->start + sizeof(SharedDataControl);
+	memcpy(base, &header, sizeof(header));
+	base += header.dataOffset;
+	for (unsigned j = 0; j <= vars.size(); j++) {
+		const DataColumn &column = (j < vars.size()) ? vars[j] : targets;
+		memcpy(base + j * header.columnBytes, column.data(), header.rows * sizeof(double));
+	}
+
+	c->hasHeader = hasHeader;
+	c->ready = 1;
+	viewColumns(data, vars, targets);
+	return 0;
+}
+
+/*
+ * Attach to a segment someone else created (fd). Returns false if it can't
+ * be used.
+ */
+static bool attach(int fd, uint64_t checksum, uint64_t fileSize, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader) {
+
+	// the publisher holds the segment exclusively until it is published (or
+	// it gives up, or dies, when the kernel lets go of its lock for it)
+	if (flock(fd, LOCK_SH) < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(SharedDataControl)) {
+		return false;
+	}
+	shared_ptr<SharedMapping> data = mapSegment(fd, st.st_size, PROT_READ);
+	if (!data) {
+		return false;
+	}
+	SharedDataControl *c = (SharedDataControl*) data->start;
+	if (c->ready != 1 || memcmp(c->magic, SHARED_DATA_MAGIC, 8) != 0 || c->checksum != checksum || c->fileSize != fileSize) {
+		return false;
+	}
+
+	// the data is only ever read
+	viewColumns(data, vars, targets);
+	hasHeader = c->hasHeader;
+	return true;
+}
+
+int readSharedDataset(const std::string &filename, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader) {
+
+	// the segment is named after the file's contents (and the user)
+	uint64_t checksum = 0xcbf29ce484222325ULL;
+	uint64_t fileSize;
+	{
+		MappedFile file;
+		if (!file.open(filename)) {
+			return readDataset(filename, vars, targets, hasHeader);
+		}
+		file.advise(MADV_SEQUENTIAL, 0, file.size());
+		// FNV-1a
+		const unsigned char *p = (const unsigned char*) file.data();
+		for (size_t i = 0; i < file.size(); i++) {
+			checksum ^= p[i];
+			checksum *= 0x100000001b3ULL;
+		}
+		fileSize = file.size();
+	}
+	stringstream s;
+	s << "/gpsr-" << getuid() << "-" << hex << checksum << "-" << dec << fileSize;
+	string name = s.str();
+
+	// a few tries, in case a segment is being removed just as we look
+	for (int tries = 0; tries < 100; tries++) {
+
+		int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) {
+			// held exclusively while loading; start again if it was taken
+			// for one left behind and removed before we could lock it
+			if (flock(fd, LOCK_EX) < 0 || !namesSegment(name, fd)) {
+				close(fd);
+				continue;
+			}
+			shared_ptr<SharedMapping> control;
+			if (ftruncate(fd, sizeof(SharedDataControl)) < 0 || !(control = mapSegment(fd, sizeof(SharedDataControl), PROT_READ | PROT_WRITE))) {
+				removeSegment(name, fd);
+				close(fd);
+				break;
+			}
+			SharedDataControl *c = (SharedDataControl*) control->start;
+			memcpy(c->magic, SHARED_DATA_MAGIC, 8);
+			c->checksum = checksum;
+			c->fileSize = fileSize;
+
+			int bad = publish(fd, control, filename, vars, targets, hasHeader);
+			if (c->ready > 0 && flock(fd, LOCK_SH) == 0) {
+				addAttached(name, fd);
+			}
+			else {
+				removeSegment(name, fd);
+				close(fd);
+			}
+			return bad;
+		}
+		if (errno != EEXIST) {
+			break;
+		}
+
+		fd = shm_open(name.c_str(), O_RDONLY, 0600);
+		if (fd < 0) {
+			if (errno == ENOENT) {
+				continue;	// just removed
+			}
+			break;
+		}
+		// nobody holding it means everyone who did has gone (killed
+		// outright, say) without removing it, or that its publisher is
+		// between letting go of its exclusive lock and taking a shared one
+		// (flock() doesn't convert locks atomically). A published segment
+		// is whole either way, so use it; any other is removed, and we
+		// start again
+		if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+			if (!isPublished(fd)) {
+				removeSegment(name, fd);
+				close(fd);
+				continue;
+			}
+			flock(fd, LOCK_UN);
+		}
+		if (attach(fd, checksum, fileSize, vars, targets, hasHeader)) {
+			addAttached(name, fd);
+			return 0;
+		}
+		close(fd);
+		usleep(1000);
+	}
+
+	return readDataset(filename, vars, targets, hasHeader);
+}
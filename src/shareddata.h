@@ -0,0 +1,56 @@
+/** \file shareddata.h
+ * Datasets shared between the gpsr processes on a host (--shared-data).
+ *
+ * The first process to load a dataset publishes it in a POSIX shared-memory
+ * segment, named after a checksum of the file; processes that load the same
+ * file later attach to the segment (read-only) and use its columns in place,
+ * instead of each holding a private copy. A segment is a SharedDataControl
+ * block followed by the dataset in the binary format (see dataio.h). Each
+ * process using a segment holds a shared flock() on it (the publisher holds
+ * it exclusively while loading), which the kernel lets go of however the
+ * process ends. A process that exits and finds nobody else holding the
+ * segment removes it. If the last ones were killed without getting the
+ * chance, the next process to load the file takes the segment over (and so
+ * removes it in turn) if it was published, and removes it otherwise.
+ *
+ * If anything goes wrong with the shared memory, the dataset is simply
+ * loaded as usual.
+ */
+
+#ifndef SHAREDDATA_H
+#define SHAREDDATA_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "global.h"
+
+#define SHARED_DATA_MAGIC "GPSRSHM2"
+
+/**
+ * The start of a shared dataset segment.
+ */
+struct SharedDataControl {
+	char magic[8];			// SHARED_DATA_MAGIC
+	uint64_t checksum;		// of the file the dataset was read from
+	uint64_t fileSize;
+	int32_t hasHeader;
+	std::atomic<int32_t> ready;	// 0 while loading, 1 when published, -1 if loading failed
+	char reserved[32];
+};
+
+/**
+ * Read a dataset through shared memory: attach to it if another process has
+ * published it, or read it and publish it.
+ * @param filename the file
+ * @param vars set to the variables, one column per variable
+ * @param targets set to the targets
+ * @param hasHeader set to false if a text file's header line doesn't start with #
+ * @return as readDataset()
+ */
+int readSharedDataset(const std::string &filename, std::vector<DataColumn> &vars, DataColumn &targets, bool &hasHeader);
+
+#endif
@@ -0,0 +1,227 @@
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "socketio.h"
+
+using namespace std;
+
+/*
+ * Split an address into a Unix-domain path, or a TCP host and port.
+ */
+static bool parseAddress(const std::string &address, bool &isUnix, std::string &host, std::string &port) {
+
+	if (address.compare(0, 5, "unix:") == 0) {
+		isUnix = true;
+		host = address.substr(5);
+		return host != "";
+	}
+
+	std::string rest = (address.compare(0, 4, "tcp:") == 0) ? address.substr(4) : address;
+	size_t colon = rest.rfind(':');
+	if (colon == std::string::npos) {
+		return false;
+	}
+	isUnix = false;
+	host = rest.substr(0, colon);
+	port = rest.substr(colon + 1);
+	return port != "";
+}
+
+/*
+ * Connect a socket, giving up after timeoutMs milliseconds (-1 = wait as long
+ * as the system does). The socket is left blocking.
+ */
+static bool connectWithin(int fd, const struct sockaddr *sa, socklen_t len, int timeoutMs) {
+
+	if (timeoutMs < 0) {
+		return connect(fd, sa, len) == 0;
+	}
+
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return false;
+	}
+	bool ok = connect(fd, sa, len) == 0;
+	if (!ok && errno == EINPROGRESS) {
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		int err = 0;
+		socklen_t errLen = sizeof(err);
+		ok = poll(&pfd, 1, timeoutMs) > 0
+			&& getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) == 0 && err == 0;
+	}
+	return fcntl(fd, F_SETFL, flags) == 0 && ok;
+}
+
+static int openSocket(const std::string &address, bool listening, int timeoutMs) {
+
+	bool isUnix;
+	std::string host, port;
+	if (!parseAddress(address, isUnix, host, port)) {
+		cerr << "Bad socket address " << address << " (use unix:/path or host:port)" << endl;
+		return -1;
+	}
+
+	if (isUnix) {
+		struct sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		if (host.size() >= sizeof(sa.sun_path)) {
+			cerr << "Socket path too long: " << host << endl;
+			return -1;
+		}
+		strcpy(sa.sun_path, host.c_str());
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+		if (listening) {
+			unlink(host.c_str());
+			if (bind(fd, (struct sockaddr*) &sa, sizeof(sa)) < 0 || listen(fd, 64) < 0) {
+				cerr << "Could not listen on " << address << ": " << strerror(errno) << endl;
+				close(fd);
+				return -1;
+			}
+		}
+		else if (!connectWithin(fd, (struct sockaddr*) &sa, sizeof(sa), timeoutMs)) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = listening ? AI_PASSIVE : 0;
+	if (getaddrinfo(host == "" ? 0 : host.c_str(), port.c_str(), &hints, &res) != 0) {
+		if (listening) {
+			cerr << "Could not resolve " << address << endl;
+		}
+		return -1;
+	}
+
+	int fd = -1;
+	for (struct addrinfo *ai = res; ai != 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) {
+			continue;
+		}
+		if (listening) {
+			int one = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) {
+				break;
+			}
+		}
+		else if (connectWithin(fd, ai->ai_addr, ai->ai_addrlen, timeoutMs)) {
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (fd < 0 && listening) {
+		cerr << "Could not listen on " << address << ": " << strerror(errno) << endl;
+	}
+	return fd;
+}
+
+int listenOn(const std::string &address) {
+	return openSocket(address, true, -1);
+}
+
+int connectTo(const std::string &address, int timeoutMs) {
+	return openSocket(address, false, timeoutMs);
+}
+
+int acceptConnection(int listenFd) {
+	return accept(listenFd, 0, 0);
+}
+
+static bool writeAll(int fd, const char *p, size_t n) {
+	while (n > 0) {
+		ssize_t done = send(fd, p, n, MSG_NOSIGNAL);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			return false;
+		}
+		p += done;
+		n -= done;
+	}
+	return true;
+}
+
+static bool readAll(int fd, char *p, size_t n) {
+	while (n > 0) {
+		ssize_t done = recv(fd, p, n, 0);
+		if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		if (done <= 0) {
+			return false;
+		}
+		p += done;
+		n -= done;
+	}
+	return true;
+}
+
+bool sendMessage(int fd, const std::string &msg) {
+	unsigned char header[4];
+	unsigned int size = msg.size();
+	for (int i = 0; i < 4; i++) {
+		header[i] = (size >> (8 * i)) & 0xff;
+	}
+	return writeAll(fd, (const char*) header, 4) && writeAll(fd, msg.data(), msg.size());
+}
+
+bool recvMessage(int fd, std::string &msg) {
+	unsigned char header[4];
+	if (!readAll(fd, (char*) header, 4)) {
+		return false;
+	}
+	unsigned int size = 0;
+	for (int i = 0; i < 4; i++) {
+		size |= (unsigned int) header[i] << (8 * i);
+	}
+	if (size > MAX_MESSAGE_SIZE) {
+		return false;
+	}
+	msg.resize(size);
+	return size == 0 || readAll(fd, &msg[0], size);
+}
+
+bool waitReadable(int fd, int timeoutMs) {
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, timeoutMs) > 0;
+}
+
+void closeSocket(int fd) {
+	if (fd >= 0) {
+		close(fd);
+	}
+}
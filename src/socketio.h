@@ -0,0 +1,70 @@
+/** \file socketio.h
+ * Sockets for talking to other gpsr processes.
+ *
+ * Addresses are either "unix:/path/to/socket" for a Unix-domain socket, or
+ * "host:port" (optionally written "tcp:host:port") for TCP. Messages are
+ * framed by their length (4 bytes, little-endian).
+ */
+
+#ifndef SOCKETIO_H
+#define SOCKETIO_H
+
+#include <string>
+
+/* the largest message we are prepared to receive */
+#define MAX_MESSAGE_SIZE (256 * 1024 * 1024)
+
+/**
+ * Create a socket listening on an address.
+ * @param address the address
+ * @return the socket, or -1 on failure (the reason is printed)
+ */
+int listenOn(const std::string &address);
+
+/**
+ * Connect to a listening socket.
+ * @param address the address
+ * @param timeoutMs how long to wait for the peer, in milliseconds (-1 = as
+ *        long as the system does, which for an unreachable host can be minutes)
+ * @return the socket, or -1 on failure
+ */
+int connectTo(const std::string &address, int timeoutMs = -1);
+
+/**
+ * Accept a connection on a listening socket.
+ * @param listenFd the listening socket
+ * @return the connection, or -1 on failure
+ */
+int acceptConnection(int listenFd);
+
+/**
+ * Send a message.
+ * @param fd the connection
+ * @param msg the message
+ * @return false if the connection failed
+ */
+bool sendMessage(int fd, const std::string &msg);
+
+/**
+ * Receive a message, waiting for all of it to arrive.
+ * @param fd the connection
+ * @param msg set to the message
+ * @return false if the connection failed or was closed
+ */
+bool recvMessage(int fd, std::string &msg);
+
+/**
+ * Wait until a socket has something to read.
+ * @param fd the socket
+ * @param timeoutMs how long to wait, in milliseconds (-1 = for ever)
+ * @return true if there is something to read (or the connection was closed)
+ */
+bool waitReadable(int fd, int timeoutMs);
+
+/**
+ * Close a socket.
+ * @param fd the socket
+ */
+void closeSocket(int fd);
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * SPSCQueue class.
+ *
+ * A bounded, lock-free queue for exactly one producer thread and one
+ * consumer thread (a ring buffer with atomic head and tail indices). Used to
+ * pass migrants between islands.
+ *
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+
+template <typename T>
+class SPSCQueue {
+
+	public:
+		/**
+		 * Constructor.
+		 * @param capacity the maximum number of items in the queue
+		 */
+		SPSCQueue(int capacity) : buffer(capacity + 1), head(0), tail(0) {
+		}
+
+		/**
+		 * Add an item (producer only).
+		 * @param item the item
+		 * @return false if the queue is full
+		 */
+		bool push(const T &item) {
+			unsigned t = tail.load(std::memory_order_relaxed);
+			unsigned next = (t + 1) % buffer.size();
+			if (next == head.load(std::memory_order_acquire)) {
+				return false;
+			}
+			buffer[t] = item;
+			tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Take the oldest item (consumer only).
+		 * @param item set to the item
+		 * @return false if the queue is empty
+		 */
+		bool pop(T &item) {
+			unsigned h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			item = buffer[h];
+			head.store((h + 1) % buffer.size(), std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::vector<T> buffer;
+		std::atomic<unsigned> head;	// next item to pop
+		std::atomic<unsigned> tail;	// next free slot
+};
+
+#endif
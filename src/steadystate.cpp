@@ -0,0 +1,210 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#include "steadystate.h"
+#include "evolve.h"
+#include "gpoperators.h"
+#include "global.h"
+#include "usefulfunctions.h"
+
+using namespace std;
+
+// tag for the random streams of the steady-state threads (see island.cpp)
+#define STEADY_STATE_STREAM 0xfffffffdUL
+
+/*
+ * The population as the threads share it.
+ */
+struct SharedPopulation {
+	GPPopulation *pop;
+	vector<mutex> slotLocks;
+	vector<atomic<double> > fitness;	// mirrors the slots' fitness, for lock-free tournaments
+
+	mutex bestLock;				// guards bestIndex/bestFitness together
+	int bestIndex;
+	double bestFitness;
+
+	atomic<long> evaluations;
+	long budget;
+	long logInterval;
+	mutex logLock;
+	condition_variable logTurn;
+	long nextLog;				// the evaluation count of the next line, so lines stay in order
+	GenerationLog *logger;
+
+	SharedPopulation(GPPopulation &p) : slotLocks(p.getSize()), fitness(p.getSize()) {
+		pop = &p;
+		for (int i = 0; i < p.getSize(); i++) {
+			fitness[i] = p.getIndividualFitness(i);
+		}
+		bestIndex = p.getIndexOfBest();
+		bestFitness = p.getIndividualFitness(bestIndex);
+	}
+};
+
+/*
+ * Tournament over the fitness mirror.
+ * @param worst find the loser instead of the winner
+ */
+static int tournament(SharedPopulation &shared, bool worst) {
+	int size = shared.pop->getSize();
+	int ret = intRandom(0, size - 1);
+	for (int k = 1; k < config->tournamentSize; k++) {
+		int competitor = intRandom(0, size - 1);
+		double f = shared.fitness[competitor];
+		if (worst ? (f > shared.fitness[ret]) : (f < shared.fitness[ret])) {
+			ret = competitor;
+		}
+	}
+	return ret;
+}
+
+static GPProgram* copySlot(SharedPopulation &shared, int i) {
+	lock_guard<mutex> lock(shared.slotLocks[i]);
+	return new GPProgram(*(shared.pop->getIndividual(i)));
+}
+
+/*
+ * Breed one child, as selection, crossover and mutation would in a
+ * generational run.
+ */
+static GPProgram* breed(SharedPopulation &shared) {
+
+	GPProgram *mom = copySlot(shared, tournament(shared, false));
+	GPProgram *child;
+
+	if (rng.flip(config->crossover_prob)) {
+		int d = tournament(shared, false);
+		if (config->no_same_mates) {
+			// never pick a mate with the same fitness
+			for (int numTries = 1; shared.fitness[d] == mom->getFitness() && numTries < NSM_MAX_TRIES; numTries++) {
+				d = tournament(shared, false);
+			}
+		}
+		GPProgram *dad = copySlot(shared, d);
+		child = xover(*mom, *dad);
+		delete dad;
+		delete mom;
+	}
+	else {
+		child = mom;
+	}
+
+	if (rng.flip(config->mutation_prob)) {
+		if (rng.flip(0.5)) {
+			nodeMutate(*child);
+		}
+		else {
+			branchMutate(*child);
+		}
+	}
+	return child;
+}
+
+/*
+ * Put a child in place of the loser of an inverse tournament (never the
+ * best individual).
+ * @param f the child's fitness (as calcFitness returned it, never NaN)
+ */
+static void insert(SharedPopulation &shared, GPProgram *child, double f) {
+
+	for (;;) {
+		int loser = tournament(shared, true);
+		lock_guard<mutex> lock(shared.slotLocks[loser]);
+
+		// the best can only move to a slot whose lock is held, so this holds
+		// for as long as we have the lock
+		lock_guard<mutex> best(shared.bestLock);
+		if (loser == shared.bestIndex && shared.pop->getSize() > 1) {
+			continue;
+		}
+
+		delete shared.pop->swapIndividual(loser, child);
+		shared.fitness[loser] = f;
+		if (f < shared.bestFitness) {
+			shared.bestFitness = f;
+			shared.bestIndex = loser;
+		}
+		return;
+	}
+}
+
+static void logBest(SharedPopulation &shared, long evaluations) {
+	int index;
+	{
+		lock_guard<mutex> best(shared.bestLock);
+		index = shared.bestIndex;
+	}
+	GPProgram *best = copySlot(shared, index);
+
+	GenerationResult result;
+	result.trainPerf = best->getFitness();
+	result.testPerf = best->getTestFitness();
+	result.trainHits = best->getNumberOfHits(config->hitsCriterion, true);
+	result.testHits = best->getNumberOfHits(config->hitsCriterion, false);
+	delete best;
+
+	unique_lock<mutex> lock(shared.logLock);
+	shared.logTurn.wait(lock, [&] { return shared.nextLog == evaluations; });
+	shared.logger->write(evaluations, result);
+	shared.nextLog = min(evaluations + shared.logInterval, shared.budget);
+	shared.logTurn.notify_all();
+}
+
+static void evolveSteadily(SharedPopulation &shared, int thread) {
+
+	rng.reseed(RNG::streamSeed(seed, STEADY_STATE_STREAM, thread));
+	int size = shared.pop->getSize();
+
+	// (an evaluation taken on is always finished, so its turn to log comes)
+	while (stopSignal == 0) {
+		long done = shared.evaluations.fetch_add(1);
+		if (done >= shared.budget) {
+			break;
+		}
+		// the generation a generational run would be at (for potency)
+		currentgen = done / size + 1;
+
+		GPProgram *child = breed(shared);
+		double f = child->calcFitness(true);
+		insert(shared, child, f);
+
+		if ((done + 1) % shared.logInterval == 0 || done + 1 == shared.budget) {
+			logBest(shared, done + 1);
+		}
+	}
+}
+
+void runSteadyState(GPPopulation &pop, GenerationLog &logger, long logInterval) {
+
+	SharedPopulation shared(pop);
+	shared.evaluations = 0;
+	shared.budget = (long) config->numgens * pop.getSize();
+	shared.logInterval = (logInterval > 0) ? logInterval : pop.getSize();
+	shared.logger = &logger;
+	shared.nextLog = min(shared.logInterval, shared.budget);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (int t = 1; t < numThreads; t++) {
+		threads.push_back(thread(evolveSteadily, ref(shared), t));
+	}
+	evolveSteadily(shared, 0);
+	for (unsigned t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long done = min((long) shared.evaluations, shared.budget);	// fewer if stopped
+	cout << "steady state:          " << done << " evaluations in " << seconds << "s ("
+		<< (seconds > 0.0 ? done / seconds : 0.0) << " evaluations/s)" << endl;
+
+	pop.setIndexOfBest(shared.bestIndex);
+}
@@ -0,0 +1,34 @@
+/** \file steadystate.h
+ * Asynchronous steady-state evolution.
+ * Instead of breeding whole generations, each thread repeatedly selects
+ * parents from the shared population by tournament, breeds one child,
+ * evaluates it and puts it in place of the loser of an inverse tournament.
+ * No thread ever waits for another to finish an evaluation, so throughput
+ * is measured in evaluations per second rather than generations.
+ *
+ * Slots are updated under one lock each, and their fitness is mirrored in
+ * an array of atomics so that tournaments never lock at all. The current
+ * best individual is never replaced. Because the threads interleave
+ * nondeterministically, steady-state runs are only reproducible with one
+ * thread.
+ */
+
+#ifndef STEADYSTATE_H
+#define STEADYSTATE_H
+
+#include "gppopulation.h"
+#include "genlog.h"
+
+/**
+ * Evolve a population in steady-state fashion on numThreads threads, for as
+ * many evaluations as numgens generations would take (numgens x popsize).
+ * The performance of the best individual is logged (in the format of
+ * logGeneration) every logInterval evaluations, with the number of
+ * evaluations in place of the generation.
+ * @param pop the population (its fitness must already have been calculated)
+ * @param logger where to log
+ * @param logInterval the number of evaluations between log lines
+ */
+void runSteadyState(GPPopulation &pop, GenerationLog &logger, long logInterval);
+
+#endif
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <functional>
+
+#include "streaming.h"
+#include "threadpool.h"
+#include "global.h"
+#include "trace.h"
+
+using namespace std;
+
+static DatasetStream *stream = 0;
+
+int openTrainingStream(const std::string &filename, long chunkCases, bool &hasHeader) {
+	delete stream;
+	stream = new DatasetStream();
+	return stream->open(filename, chunkCases, hasHeader);
+}
+
+DatasetStream* trainingStream() {
+	return stream;
+}
+
+long numTrainingCases() {
+	return (stream != 0) ? stream->getNumCases() : (long) targets.size();
+}
+
+/*
+ * One pass over the training data: each chunk in turn takes the place of
+ * the training set (variables, targets) and is handed to the body, while the
+ * next one is read.
+ */
+static void streamPass(const function<void(int ncases)> &body) {
+
+	for (int c = 0; c < stream->getNumChunks(); c++) {
+		long bad = stream->fetch(c, variables, targets);
+		if (bad > 0) {
+			cerr << "Something went wrong reading in the training data" << endl;
+			cerr << "at line " << bad << endl;
+			exit(1);
+		}
+		stream->prefetch(c + 1);
+		body(targets.size());
+	}
+	variables.clear();
+	targets = DataColumn();
+}
+
+/*
+ * Running sums over the chunks for one individual: moments of its guesses
+ * (e) and the targets (t), merged chunk by chunk (Chan et al.) for new LS
+ * coefficients, or else its squared error with the coefficients it has.
+ */
+struct StreamSums {
+	double n;
+	double meanE;
+	double meanT;
+	double m2E;	// sum of (e - meanE)^2
+	double m2T;	// sum of (t - meanT)^2
+	double cET;	// sum of (e - meanE) * (t - meanT)
+	double sse;
+};
+
+static void addChunk(StreamSums &s, const ResultType &e, const DataColumn &t, bool moments, double a, double b) {
+
+	double n = e.size();
+	if (!moments) {
+		for (unsigned i = 0; i < e.size(); i++) {
+			double err = (a + b * e[i]) - t[i];
+			s.sse += err * err;
+		}
+		s.n += n;
+		return;
+	}
+
+	double meanE = 0.0;
+	double meanT = 0.0;
+	for (unsigned i = 0; i < e.size(); i++) {
+		meanE += e[i];
+		meanT += t[i];
+	}
+	meanE /= n;
+	meanT /= n;
+
+	double m2E = 0.0;
+	double m2T = 0.0;
+	double cET = 0.0;
+	for (unsigned i = 0; i < e.size(); i++) {
+		double dE = e[i] - meanE;
+		double dT = t[i] - meanT;
+		m2E += dE * dE;
+		m2T += dT * dT;
+		cET += dE * dT;
+	}
+
+	double total = s.n + n;
+	double dE = meanE - s.meanE;
+	double dT = meanT - s.meanT;
+	s.m2E += m2E + dE * dE * s.n * n / total;
+	s.m2T += m2T + dT * dT * s.n * n / total;
+	s.cET += cET + dE * dT * s.n * n / total;
+	s.meanE += dE * n / total;
+	s.meanT += dT * n / total;
+	s.n = total;
+}
+
+void streamPopulationFitness(const std::vector<GPProgram*> &population, const std::vector<char> &applyScaling) {
+
+	StreamSums zero = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	vector<StreamSums> sums(population.size(), zero);
+	vector<char> moments(population.size());
+	vector<double> costs(population.size());
+	for (unsigned i = 0; i < population.size(); i++) {
+		moments[i] = config->linear_scaling && applyScaling[i];
+		costs[i] = population[i]->getSize();
+	}
+
+	streamPass([&](int ncases) {
+		workerPool().run(costs, [&](int i) {
+			TRACE_SPAN("evaluate", i);
+			GPProgram *gpr = population[i];
+			double a = config->linear_scaling ? gpr->getLSCoeffA() : 0.0;
+			double b = config->linear_scaling ? gpr->getLSCoeffB() : 1.0;
+			addChunk(sums[i], gpr->evaluate(true, 0, ncases), targets, moments[i], a, b);
+		});
+	});
+
+	for (unsigned i = 0; i < population.size(); i++) {
+		StreamSums &s = sums[i];
+		if (moments[i]) {
+			double b = 1.0;
+			if (s.m2E != 0.0) {
+				b = s.cET / s.m2E;
+			}
+			else if (s.meanE == 0.0) {
+				b = 1.0;
+			}
+			else {
+				b = s.meanT / s.meanE;
+			}
+			population[i]->setLSCoeffA(s.meanT - (b * s.meanE));
+			population[i]->setLSCoeffB(b);
+
+			// sum of ((t - meanT) - b (e - meanE))^2
+			s.sse = s.m2T - 2.0 * b * s.cET + b * b * s.m2E;
+			if (s.sse < 0.0) {
+				s.sse = 0.0;	// rounding
+			}
+		}
+		population[i]->setFitness(s.sse / s.n);
+	}
+}
+
+int streamNumberOfHits(GPProgram &prog, double criterion) {
+
+	int hits = 0;
+	double a = prog.getLSCoeffA();
+	double b = prog.getLSCoeffB();
+	streamPass([&](int ncases) {
+		ResultType guesses = prog.evaluate(true, 0, ncases);
+		for (int i = 0; i < ncases; i++) {
+			if (abs(targets[i] - (a + b * guesses[i])) <= criterion) {
+				hits++;
+			}
+		}
+	});
+	return hits;
+}
@@ -0,0 +1,62 @@
+/** \file streaming.h
+ * Out-of-core evaluation, for training sets too big for memory (--stream).
+ *
+ * The training data is read a chunk of fitness cases at a time (see
+ * DatasetStream) instead of being loaded: each chunk in turn stands in for
+ * the whole training set while the population is evaluated on it, and the
+ * next chunk is read on a background thread meanwhile. Each individual keeps
+ * running sums (moments of its guesses and the targets, merged chunk by
+ * chunk, and its squared error), from which its LS coefficients and fitness
+ * follow at the end of the pass. Memory use therefore depends on the chunk
+ * size and the population, not on the size of the dataset. The testing data
+ * is still held in memory.
+ *
+ * Without linear scaling the fitness is exactly as if the data were in
+ * memory; with it, the same up to rounding.
+ */
+
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <string>
+#include <vector>
+
+#include "gpprogram.h"
+#include "dataio.h"
+
+/**
+ * Open the training data for streaming.
+ * @param filename the file
+ * @param chunkCases the number of fitness cases in a chunk
+ * @param hasHeader set to false if a text file's header line doesn't start with #
+ * @return as readDataset()
+ */
+int openTrainingStream(const std::string &filename, long chunkCases, bool &hasHeader);
+
+/**
+ * @return the training data stream, or 0 if the training data is in memory
+ */
+DatasetStream* trainingStream();
+
+/**
+ * @return the number of training fitness cases (streamed or not)
+ */
+long numTrainingCases();
+
+/**
+ * Evaluate individuals on the streamed training data (one pass), as
+ * GPProgram::calcFitness(true, applyScaling[i]) would.
+ * @param population the individuals
+ * @param applyScaling whether to recompute each one's LS coefficients
+ */
+void streamPopulationFitness(const std::vector<GPProgram*> &population, const std::vector<char> &applyScaling);
+
+/**
+ * Count an individual's hits on the streamed training data (one pass).
+ * @param prog the individual
+ * @param criterion the hits criterion
+ * @return the number of hits
+ */
+int streamNumberOfHits(GPProgram &prog, double criterion);
+
+#endif
@@ -0,0 +1,345 @@
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+#include "synthetic.h"
+#include "rng.h"
+
+using namespace std;
+
+/* the operations of a compiled formula */
+enum FormulaOp {
+	F_VAR, F_NUMBER, F_ADD, F_SUB, F_MUL, F_DIV, F_POW, F_NEG,
+	F_SIN, F_COS, F_TAN, F_EXP, F_LOG, F_SQRT, F_ABS, F_TANH
+};
+
+static const char *functionNames[] = { "sin", "cos", "tan", "exp", "log", "sqrt", "abs", "tanh" };
+#define NUM_FUNCTIONS 8
+
+/* draws of a case whose target isn't finite, before giving up */
+#define MAX_REDRAWS 1000
+
+struct NamedFormula {
+	const char *name;
+	const char *expression;
+	double low, high;
+};
+
+static const NamedFormula namedFormulas[] = {
+	{ "quartic", "x0^4 + x0^3 + x0^2 + x0", -1.0, 1.0 },
+	{ "nguyen7", "log(x0+1) + log(x0^2+1)", 0.0, 2.0 },
+	{ "friedman1", "10*sin(pi*x0*x1) + 20*(x2-0.5)^2 + 10*x3 + 5*x4", 0.0, 1.0 }
+};
+#define NUM_NAMED 3
+
+//
+// TargetFormula
+//
+
+TargetFormula::TargetFormula() {
+	depth = maxDepth = 0;
+	numVariables = 0;
+	named = false;
+	namedLow = namedHigh = 0.0;
+}
+
+static void skipSpace(const string &text, size_t &pos) {
+	while (pos < text.size() && isspace((unsigned char) text[pos])) {
+		pos++;
+	}
+}
+
+bool TargetFormula::parse(const std::string &text, std::string &error) {
+
+	code.clear();
+	depth = maxDepth = 0;
+	numVariables = 0;
+	named = false;
+	string expression = text;
+	for (int i = 0; i < NUM_NAMED; i++) {
+		if (text == namedFormulas[i].name) {
+			expression = namedFormulas[i].expression;
+			named = true;
+			namedLow = namedFormulas[i].low;
+			namedHigh = namedFormulas[i].high;
+		}
+	}
+
+	size_t pos = 0;
+	if (!parseSum(expression, pos, error)) {
+		return false;
+	}
+	skipSpace(expression, pos);
+	if (pos < expression.size()) {
+		error = "unexpected '" + expression.substr(pos, 1) + "'";
+		return false;
+	}
+	return true;
+}
+
+void TargetFormula::emit(int op, int var, double value) {
+	Term t;
+	t.op = op;
+	t.var = var;
+	t.value = value;
+	code.push_back(t);
+
+	if (op == F_VAR || op == F_NUMBER) {
+		maxDepth = max(maxDepth, ++depth);
+	}
+	else if (op < F_NEG) {
+		depth--;	// a binary operator
+	}
+}
+
+// sum: product (('+' | '-') product)*
+bool TargetFormula::parseSum(const std::string &text, size_t &pos, std::string &error) {
+
+	if (!parseProduct(text, pos, error)) {
+		return false;
+	}
+	skipSpace(text, pos);
+	while (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+		int op = (text[pos] == '+') ? F_ADD : F_SUB;
+		pos++;
+		if (!parseProduct(text, pos, error)) {
+			return false;
+		}
+		emit(op, 0, 0.0);
+		skipSpace(text, pos);
+	}
+	return true;
+}
+
+// product: unary (('*' | '/') unary)*
+bool TargetFormula::parseProduct(const std::string &text, size_t &pos, std::string &error) {
+
+	if (!parseUnary(text, pos, error)) {
+		return false;
+	}
+	skipSpace(text, pos);
+	while (pos < text.size() && (text[pos] == '*' || text[pos] == '/')) {
+		int op = (text[pos] == '*') ? F_MUL : F_DIV;
+		pos++;
+		if (!parseUnary(text, pos, error)) {
+			return false;
+		}
+		emit(op, 0, 0.0);
+		skipSpace(text, pos);
+	}
+	return true;
+}
+
+// unary: '-' unary | primary ('^' unary)?
+bool TargetFormula::parseUnary(const std::string &text, size_t &pos, std::string &error) {
+
+	skipSpace(text, pos);
+	if (pos < text.size() && text[pos] == '-') {
+		pos++;
+		if (!parseUnary(text, pos, error)) {
+			return false;
+		}
+		emit(F_NEG, 0, 0.0);
+		return true;
+	}
+	if (!parsePrimary(text, pos, error)) {
+		return false;
+	}
+	skipSpace(text, pos);
+	if (pos < text.size() && text[pos] == '^') {
+		pos++;
+		if (!parseUnary(text, pos, error)) {
+			return false;
+		}
+		emit(F_POW, 0, 0.0);
+	}
+	return true;
+}
+
+// primary: number | pi | xN | function '(' sum ')' | '(' sum ')'
+bool TargetFormula::parsePrimary(const std::string &text, size_t &pos, std::string &error) {
+
+	skipSpace(text, pos);
+	if (pos >= text.size()) {
+		error = "the formula ends too soon";
+		return false;
+	}
+	if (isdigit((unsigned char) text[pos]) || text[pos] == '.') {
+		const char *start = text.c_str() + pos;
+		char *end;
+		double value = strtod(start, &end);
+		if (end == start) {
+			error = "bad number at '" + text.substr(pos) + "'";
+			return false;
+		}
+		pos += end - start;
+		emit(F_NUMBER, 0, value);
+		return true;
+	}
+	if (text[pos] == '(') {
+		pos++;
+		if (!parseSum(text, pos, error)) {
+			return false;
+		}
+		skipSpace(text, pos);
+		if (pos >= text.size() || text[pos] != ')') {
+			error = "missing ')'";
+			return false;
+		}
+		pos++;
+		return true;
+	}
+
+	size_t start = pos;
+	while (pos < text.size() && isalnum((unsigned char) text[pos])) {
+		pos++;
+	}
+	string word = text.substr(start, pos - start);
+	if (word == "pi") {
+		emit(F_NUMBER, 0, M_PI);
+		return true;
+	}
+	if (word.size() > 1 && word[0] == 'x' && word.find_first_not_of("0123456789", 1) == string::npos) {
+		int var = atoi(word.c_str() + 1);
+		numVariables = max(numVariables, var + 1);
+		emit(F_VAR, var, 0.0);
+		return true;
+	}
+	for (int f = 0; f < NUM_FUNCTIONS; f++) {
+		if (word == functionNames[f]) {
+			skipSpace(text, pos);
+			if (pos >= text.size() || text[pos] != '(') {
+				error = "missing '(' after " + word;
+				return false;
+			}
+			if (!parsePrimary(text, pos, error)) {
+				return false;
+			}
+			emit(F_SIN + f, 0, 0.0);
+			return true;
+		}
+	}
+	error = (word == "") ? "unexpected '" + text.substr(pos, 1) + "'" : "unknown name '" + word + "'";
+	return false;
+}
+
+int TargetFormula::getNumVariables() const {
+	return numVariables;
+}
+
+bool TargetFormula::getRange(double &low, double &high) const {
+	if (named) {
+		low = namedLow;
+		high = namedHigh;
+	}
+	return named;
+}
+
+double TargetFormula::evaluate(const double *x) const {
+
+	static thread_local vector<double> stack;
+	if ((int) stack.size() < maxDepth) {
+		stack.resize(maxDepth);
+	}
+	double *s = stack.data();
+	int sp = 0;
+	for (unsigned i = 0; i < code.size(); i++) {
+		const Term &t = code[i];
+		switch (t.op) {
+			case F_VAR: s[sp++] = x[t.var]; break;
+			case F_NUMBER: s[sp++] = t.value; break;
+			case F_ADD: sp--; s[sp - 1] += s[sp]; break;
+			case F_SUB: sp--; s[sp - 1] -= s[sp]; break;
+			case F_MUL: sp--; s[sp - 1] *= s[sp]; break;
+			case F_DIV: sp--; s[sp - 1] /= s[sp]; break;
+			case F_POW: sp--; s[sp - 1] = pow(s[sp - 1], s[sp]); break;
+			case F_NEG: s[sp - 1] = -s[sp - 1]; break;
+			case F_SIN: s[sp - 1] = sin(s[sp - 1]); break;
+			case F_COS: s[sp - 1] = cos(s[sp - 1]); break;
+			case F_TAN: s[sp - 1] = tan(s[sp - 1]); break;
+			case F_EXP: s[sp - 1] = exp(s[sp - 1]); break;
+			case F_LOG: s[sp - 1] = log(s[sp - 1]); break;
+			case F_SQRT: s[sp - 1] = sqrt(s[sp - 1]); break;
+			case F_ABS: s[sp - 1] = fabs(s[sp - 1]); break;
+			case F_TANH: s[sp - 1] = tanh(s[sp - 1]); break;
+		}
+	}
+	return s[0];
+}
+
+//
+// generating datasets
+//
+
+SyntheticSpec::SyntheticSpec() {
+	rows = 1000;
+	variables = 0;
+	noise = 0.0;
+	formula = "quartic";
+	low = -1.0;
+	high = 1.0;
+	seed = 1;
+}
+
+bool generateDataset(const SyntheticSpec &spec, std::vector<DataColumn> &vars, DataColumn &targets, std::string &error) {
+
+	TargetFormula formula;
+	if (!formula.parse(spec.formula, error)) {
+		return false;
+	}
+	int numVars = max(spec.variables, formula.getNumVariables());
+	if (spec.rows < 1 || numVars < 1 || !(spec.low <= spec.high)) {
+		ostringstream s;
+		s << "can't make " << spec.rows << " cases of " << numVars << " variables on [" << spec.low << ", " << spec.high << "]";
+		error = s.str();
+		return false;
+	}
+
+	// a generator of its own, so the data only depends on the seed
+	RNG r(spec.seed);
+	vars.assign(numVars, DataColumn());
+	for (int j = 0; j < numVars; j++) {
+		vars[j].resize(spec.rows);
+	}
+	targets.resize(spec.rows);
+	vector<double> x(numVars);
+	for (long i = 0; i < spec.rows; i++) {
+		double y = NAN;
+		for (int tries = 0; tries < MAX_REDRAWS && !std::isfinite(y); tries++) {
+			for (int j = 0; j < numVars; j++) {
+				x[j] = spec.low + r.uniform() * (spec.high - spec.low);
+			}
+			y = formula.evaluate(x.data());
+		}
+		if (!std::isfinite(y)) {
+			error = "the formula isn't finite over the range of the variables";
+			return false;
+		}
+		for (int j = 0; j < numVars; j++) {
+			vars[j][i] = x[j];
+		}
+		targets[i] = y;
+	}
+
+	if (spec.noise > 0.0) {
+		double mean = 0.0;
+		for (long i = 0; i < spec.rows; i++) {
+			mean += targets[i];
+		}
+		mean /= spec.rows;
+		double var = 0.0;
+		for (long i = 0; i < spec.rows; i++) {
+			var += (targets[i] - mean) * (targets[i] - mean);
+		}
+		double sd = spec.noise * sqrt(var / spec.rows);
+
+		// Box-Muller
+		for (long i = 0; i < spec.rows; i++) {
+			double u = 1.0 - r.uniform();
+			double v = r.uniform();
+			targets[i] += sd * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,114 @@
+/** \file synthetic.h
+ * Synthetic regression datasets ("gpsr generate").
+ *
+ * A dataset is drawn from a target formula: each variable is drawn
+ * uniformly from a range, the target is the formula of the variables, and
+ * Gaussian noise can be added to the targets. The formula is an expression
+ * of the variables x0, x1, ... with + - * / ^ (power), the functions sin,
+ * cos, tan, exp, log, sqrt, abs and tanh, numbers and pi, e.g.
+ *
+ *     10*sin(pi*x0*x1) + 20*(x2-0.5)^2 + 10*x3 + 5*x4
+ *
+ * or the name of one of the formulas below (which come with their own
+ * range):
+ *
+ *     quartic    x0^4 + x0^3 + x0^2 + x0 on [-1, 1] (as datasets/quartic_*.dat)
+ *     nguyen7    log(x0+1) + log(x0^2+1) on [0, 2]
+ *     friedman1  10*sin(pi*x0*x1) + 20*(x2-0.5)^2 + 10*x3 + 5*x4 on [0, 1]
+ *
+ * Datasets only depend on their settings (the seed included), so the same
+ * settings always give the same data.
+ */
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <string>
+#include <vector>
+
+#include "datacolumn.h"
+
+/**
+ * A target formula, compiled to run on a stack.
+ */
+class TargetFormula {
+
+	public:
+
+		TargetFormula();
+
+		/**
+		 * Compile a formula.
+		 * @param text the formula (an expression or the name of a formula)
+		 * @param error set to what is wrong with it
+		 * @return false if it isn't a formula
+		 */
+		bool parse(const std::string &text, std::string &error);
+
+		/**
+		 * Gets the number of variables the formula needs (one more than the
+		 * highest it uses).
+		 */
+		int getNumVariables() const;
+
+		/**
+		 * Gets the range of the variables of a named formula.
+		 * @return false if the formula hasn't a range of its own
+		 */
+		bool getRange(double &low, double &high) const;
+
+		/**
+		 * Work out the formula.
+		 * @param x the variables
+		 * @return its value
+		 */
+		double evaluate(const double *x) const;
+
+	private:
+
+		struct Term {
+			int op;
+			int var;
+			double value;
+		};
+
+		std::vector<Term> code;
+		int depth, maxDepth;	// of the stack the code works on
+		int numVariables;
+		bool named;
+		double namedLow, namedHigh;
+
+		// the recursive descent parser (pos: where it is in text)
+		bool parseSum(const std::string &text, size_t &pos, std::string &error);
+		bool parseProduct(const std::string &text, size_t &pos, std::string &error);
+		bool parseUnary(const std::string &text, size_t &pos, std::string &error);
+		bool parsePrimary(const std::string &text, size_t &pos, std::string &error);
+		void emit(int op, int var, double value);
+};
+
+/**
+ * The settings of a synthetic dataset.
+ */
+struct SyntheticSpec {
+	long rows;
+	int variables;		// at least as many as the formula needs (the rest are irrelevant)
+	double noise;		// the standard deviation of the noise, relative to that of the targets
+	std::string formula;
+	double low, high;	// the range of the variables
+	unsigned long seed;
+
+	SyntheticSpec();
+};
+
+/**
+ * Draw a synthetic dataset. Cases whose target isn't finite (outside the
+ * formula's domain) are drawn again.
+ * @param spec the settings
+ * @param vars set to the variables
+ * @param targets set to the targets
+ * @param error set to what went wrong
+ * @return false if the settings don't make a dataset
+ */
+bool generateDataset(const SyntheticSpec &spec, std::vector<DataColumn> &vars, DataColumn &targets, std::string &error);
+
+#endif
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include "threadpool.h"
+#include "global.h"
+#include "trace.h"
+
+using namespace std;
+
+// whether this thread is running tasks of a job (so a run() from a task is nested)
+static thread_local bool insideJob = false;
+
+ThreadPool::ThreadPool(int numThreads) :
+	numThreads((numThreads < 1) ? 1 : numThreads),
+	queues((numThreads < 1) ? 1 : numThreads) {
+
+	this->task = 0;
+	this->activeWorkers = 0;
+	this->jobId = 0;
+	this->stopping = false;
+	resetStats();
+
+	for (int i = 1; i < this->numThreads; i++) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (unsigned i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+int ThreadPool::getNumThreads() const {
+	return numThreads;
+}
+
+void ThreadPool::run(int numTasks, const Task &task) {
+	run(vector<double>(numTasks, 1.0), task);
+}
+
+void ThreadPool::run(const vector<double> &costs, const Task &task) {
+
+	int numTasks = costs.size();
+
+	// nothing to share the work with (or we are already inside a job, or
+	// another thread has the pool), so just do it here
+	if (insideJob || workers.empty() || numTasks <= 1) {
+		for (int i = 0; i < numTasks; i++) {
+			task(i);
+		}
+		return;
+	}
+	unique_lock<mutex> submitLock(submitMutex, try_to_lock);
+	if (!submitLock.owns_lock()) {
+		for (int i = 0; i < numTasks; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// deal the tasks out, most expensive first, to the least loaded thread
+	vector<int> order(numTasks);
+	for (int i = 0; i < numTasks; i++) {
+		order[i] = i;
+	}
+	stable_sort(order.begin(), order.end(), [&](int a, int b) { return costs[a] > costs[b]; });
+
+	vector<double> load(numThreads, 0.0);
+	{
+		lock_guard<mutex> lock(jobMutex);
+		for (int i = 0; i < numTasks; i++) {
+			int target = min_element(load.begin(), load.end()) - load.begin();
+			load[target] += costs[order[i]];
+			queues[target].tasks.push_back(order[i]);
+		}
+		this->task = &task;
+		this->activeWorkers = workers.size();
+		this->jobId++;
+	}
+	jobReady.notify_all();
+
+	// the calling thread works too
+	work(0);
+
+	unique_lock<mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return activeWorkers == 0; });
+	this->task = 0;
+
+	elapsedSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool ThreadPool::nextTask(int self, int &task, bool &stolen) {
+
+	// own work first, biggest tasks first
+	{
+		WorkQueue &own = queues[self];
+		lock_guard<mutex> lock(own.lock);
+		if (!own.tasks.empty()) {
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			stolen = false;
+			return true;
+		}
+	}
+
+	// then steal the smallest task of the next thread that has any left
+	for (int i = 1; i < numThreads; i++) {
+		WorkQueue &victim = queues[(self + i) % numThreads];
+		lock_guard<mutex> lock(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			stolen = true;
+			return true;
+		}
+	}
+
+	// no new tasks are added during a job, so we're done
+	return false;
+}
+
+void ThreadPool::work(int self) {
+
+	int i;
+	bool stolen;
+	WorkerStats &mine = stats[self];
+
+	insideJob = true;
+	while (nextTask(self, i, stolen)) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		(*task)(i);
+		mine.busySeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		mine.tasks++;
+		if (stolen) {
+			mine.steals++;
+		}
+	}
+	insideJob = false;
+}
+
+void ThreadPool::workerLoop(int self) {
+
+	setTraceThreadName("worker " + to_string(self));
+	unsigned long lastJob = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(jobMutex);
+			jobReady.wait(lock, [&] { return stopping || jobId != lastJob; });
+			if (stopping) {
+				return;
+			}
+			lastJob = jobId;
+		}
+
+		work(self);
+
+		{
+			lock_guard<mutex> lock(jobMutex);
+			activeWorkers--;
+		}
+		jobDone.notify_one();
+	}
+}
+
+vector<ThreadPool::WorkerStats> ThreadPool::getStats() const {
+	return stats;
+}
+
+double ThreadPool::getElapsedSeconds() const {
+	return elapsedSeconds;
+}
+
+void ThreadPool::resetStats() {
+	WorkerStats zero = { 0.0, 0, 0 };
+	stats.assign(numThreads, zero);
+	elapsedSeconds = 0.0;
+}
+
+ThreadPool& workerPool() {
+	static ThreadPool pool(numThreads);
+	return pool;
+}
@@ -0,0 +1,134 @@
+/**
+ * ThreadPool class.
+ *
+ * A persistent pool of worker threads. The workers are started once and
+ * sleep between jobs. A job is a number of independent tasks (numbered
+ * 0 .. numTasks-1); run() only returns once the whole job has completed.
+ *
+ * Tasks are scheduled by work stealing: every thread (the calling thread
+ * included) has its own deque of tasks. When a job starts, the tasks are
+ * dealt out according to their estimated cost, largest first, each to the
+ * thread with the least work so far. A thread takes tasks from the front of
+ * its own deque (the big ones first) and, once it runs dry, steals from the
+ * back of the other deques (the small ones), so nobody sits idle while
+ * another thread works through a few giant tasks.
+ *
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+class ThreadPool {
+
+	public:
+		/**
+		 * A task, called with the index of the task within the job.
+		 */
+		typedef std::function<void(int)> Task;
+
+		/**
+		 * Per-thread counters, accumulated over jobs until resetStats().
+		 */
+		struct WorkerStats {
+			double busySeconds;	// time spent running tasks
+			long tasks;		// number of tasks run
+			long steals;		// number of those taken from another deque
+		};
+
+		/**
+		 * Constructor.
+		 * @param numThreads the total number of threads that work on a job,
+		 * including the calling thread (so numThreads - 1 workers are started)
+		 */
+		ThreadPool(int numThreads);
+
+		/**
+		 * Destructor. Stops and joins the workers.
+		 */
+		~ThreadPool();
+
+		/**
+		 * Gets the number of threads that work on a job.
+		 * @return the number of threads (including the calling thread)
+		 */
+		int getNumThreads() const;
+
+		/**
+		 * Run a job of equally expensive tasks and wait for it to finish.
+		 * If the pool is already busy (e.g. run() is called from within a task)
+		 * the job is run inline on the calling thread instead.
+		 * @param numTasks the number of tasks in the job
+		 * @param task the task to run for each index
+		 */
+		void run(int numTasks, const Task &task);
+
+		/**
+		 * Run a job and wait for it to finish, using the estimated cost of each
+		 * task for the initial assignment of tasks to threads.
+		 * @param costs the estimated cost of each task (one entry per task)
+		 * @param task the task to run for each index
+		 */
+		void run(const std::vector<double> &costs, const Task &task);
+
+		/**
+		 * Gets the counters of each thread (index 0 is the calling thread).
+		 * @return the per-thread counters
+		 */
+		std::vector<WorkerStats> getStats() const;
+
+		/**
+		 * Gets the wall-clock time spent inside run() since the last reset.
+		 * @return the elapsed time in seconds
+		 */
+		double getElapsedSeconds() const;
+
+		/**
+		 * Resets the counters and the elapsed time.
+		 */
+		void resetStats();
+
+	private:
+		struct WorkQueue {
+			std::mutex lock;
+			std::deque<int> tasks;
+		};
+
+		void workerLoop(int self);
+		void work(int self);
+		bool nextTask(int self, int &task, bool &stolen);
+
+		std::vector<std::thread> workers;
+		int numThreads;
+		std::vector<WorkQueue> queues;
+		std::vector<WorkerStats> stats;
+		double elapsedSeconds;
+
+		// protects the job description and the wakeup/finish conditions
+		std::mutex jobMutex;
+		std::condition_variable jobReady;
+		std::condition_variable jobDone;
+		// only one job runs at a time
+		std::mutex submitMutex;
+
+		const Task *task;
+		int activeWorkers;
+		unsigned long jobId;
+		bool stopping;
+};
+
+/**
+ * Gets the shared worker pool. The pool is created on first use with the
+ * number of threads given by the global numThreads setting.
+ * @return the shared pool
+ */
+ThreadPool& workerPool();
+
+#endif
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <algorithm>
+
+#include "timing.h"
+#include "trace.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const char *phaseNames[NUM_PHASES] = {
+	"selection", "crossover", "mutation", "breeding", "fitness", "test", "migration", "logging", "checkpoint"
+};
+
+static thread_local double phaseSeconds[NUM_PHASES];
+static thread_local Clock::time_point generationStart;
+static atomic<long long> casesEvaluated(0);
+static atomic<long long> nodesEvaluated(0);
+
+PhaseTimer::PhaseTimer(TimedPhase p) {
+	phase = p;
+	start = Clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+	Clock::time_point end = Clock::now();
+	phaseSeconds[phase] += chrono::duration<double>(end - start).count();
+	if (tracing()) {
+		recordSpan(phaseNames[phase], start, end, -1);
+	}
+}
+
+void countEvaluation(long nodes, long cases) {
+	casesEvaluated.fetch_add(cases, memory_order_relaxed);
+	nodesEvaluated.fetch_add((long long) nodes * cases, memory_order_relaxed);
+}
+
+void startGenerationTiming() {
+	for (int p = 0; p < NUM_PHASES; p++) {
+		phaseSeconds[p] = 0.0;
+	}
+	casesEvaluated = 0;
+	nodesEvaluated = 0;
+	generationStart = Clock::now();
+}
+
+GenerationTiming getGenerationTiming() {
+	GenerationTiming ret;
+	for (int p = 0; p < NUM_PHASES; p++) {
+		ret.seconds[p] = phaseSeconds[p];
+	}
+	ret.total = chrono::duration<double>(Clock::now() - generationStart).count();
+	ret.cases = casesEvaluated;
+	ret.nodes = nodesEvaluated;
+	return ret;
+}
+
+void writeTimingHeader(std::ostream &os) {
+	os << "# generation";
+	for (int p = 0; p < NUM_PHASES; p++) {
+		os << "\t" << phaseNames[p];
+	}
+	os << "\tother\ttotal\tcases\tnodes\n";
+}
+
+void writeTiming(std::ostream &os, int generation, const GenerationTiming &timing) {
+	double timed = 0.0;
+	os << generation;
+	for (int p = 0; p < NUM_PHASES; p++) {
+		os << "\t" << timing.seconds[p];
+		timed += timing.seconds[p];
+	}
+	os << "\t" << max(0.0, timing.total - timed) << "\t" << timing.total << "\t" << timing.cases << "\t" << timing.nodes << "\n";
+}
@@ -0,0 +1,107 @@
+/** \file timing.h
+ * Per-generation timing of the generational loop (--timing-log).
+ *
+ * The phases of a generation (selection, crossover, mutation or parallel
+ * breeding, fitness evaluation, evaluation of the best individual on the
+ * testing data, migration, logging and checkpointing) are timed with the
+ * steady clock by scoped timers, and every call of GPProgram::evaluate
+ * counts the fitness cases and nodes it works out. A timer costs two clock
+ * reads and the counts an atomic add per call, so they are always on; the
+ * timing log just writes them out once a generation.
+ *
+ * Building with -DGPSR_NO_TIMING compiles all of it out (TIME_PHASE and
+ * COUNT_EVALUATION expand to nothing, and --timing-log is refused).
+ *
+ * The phase times belong to the thread that ran the generation (so each
+ * island keeps its own); the counts are for the whole process. The phases
+ * are also spans of the trace, when tracing (see trace.h).
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <ostream>
+#include <chrono>
+
+/**
+ * The timed phases of a generation.
+ */
+enum TimedPhase {
+	PHASE_SELECTION,
+	PHASE_CROSSOVER,
+	PHASE_MUTATION,
+	PHASE_BREEDING,		// selection, crossover and mutation together (-B)
+	PHASE_FITNESS,
+	PHASE_TEST,		// the best individual's testing fitness and hits
+	PHASE_MIGRATION,
+	PHASE_LOGGING,
+	PHASE_CHECKPOINT,
+	NUM_PHASES
+};
+
+/**
+ * The times and counts of one generation.
+ */
+struct GenerationTiming {
+	double seconds[NUM_PHASES];
+	double total;			// the whole generation, wall clock
+	long long cases;		// fitness cases evaluated (by every individual)
+	long long nodes;		// nodes evaluated (nodes x cases)
+};
+
+/**
+ * Times the scope it lives in and adds it to a phase of this thread.
+ */
+class PhaseTimer {
+
+	public:
+
+		PhaseTimer(TimedPhase p);
+		~PhaseTimer();
+
+	private:
+
+		TimedPhase phase;
+		std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Count an evaluation (see COUNT_EVALUATION).
+ * @param nodes the size of the genome
+ * @param cases the number of fitness cases
+ */
+void countEvaluation(long nodes, long cases);
+
+/**
+ * Start timing a generation on this thread: clears its phase times and
+ * the counts.
+ */
+void startGenerationTiming();
+
+/**
+ * Gets the times of this thread's generation, and the counts, since
+ * startGenerationTiming().
+ */
+GenerationTiming getGenerationTiming();
+
+/**
+ * Write the header line of a timing log.
+ */
+void writeTimingHeader(std::ostream &os);
+
+/**
+ * Write a generation's line of a timing log: the generation, the seconds
+ * spent in each phase, in the rest of the generation and in all of it, and
+ * the fitness cases and nodes evaluated, separated by tabs.
+ */
+void writeTiming(std::ostream &os, int generation, const GenerationTiming &timing);
+
+#ifndef GPSR_NO_TIMING
+#define TIME_PHASE(phase) PhaseTimer phaseTimer(phase)
+#define COUNT_EVALUATION(nodes, cases) countEvaluation(nodes, cases)
+#else
+#define TIME_PHASE(phase)
+#define COUNT_EVALUATION(nodes, cases)
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <fstream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/* spans per block of a thread's buffer */
+#define TRACE_BLOCK 4096
+
+struct TraceEvent {
+	const char *name;
+	long long start;	// ns since tracing started
+	long long duration;	// ns
+	long arg;
+};
+
+struct TraceBlock {
+	TraceEvent events[TRACE_BLOCK];
+	atomic<int> used;
+	atomic<TraceBlock*> next;
+
+	TraceBlock() : used(0), next(nullptr) {}
+};
+
+/*
+ * A thread's buffer. Only its thread writes to it; the writer of the trace
+ * reads the spans published (used) so far.
+ */
+struct ThreadTrace {
+	long tid;
+	string name;
+	TraceBlock *first;
+	TraceBlock *last;
+	long spans;
+	atomic<long> dropped;
+	ThreadTrace *next;	// in the list of every thread's buffer
+};
+
+static atomic<bool> on(false);
+static string traceFile;
+static Clock::time_point epoch;
+static atomic<ThreadTrace*> traces(nullptr);
+static atomic<bool> written(false);
+static thread_local ThreadTrace *myTrace = 0;
+static thread_local string threadName;
+
+static void writeTraceAtExit() {
+	writeTrace();
+}
+
+void startTracing(const std::string &filename) {
+	traceFile = filename;
+	epoch = Clock::now();
+	if (threadName == "") {
+		threadName = "main";
+	}
+	on = true;
+	atexit(writeTraceAtExit);
+}
+
+bool tracing() {
+	return on.load(memory_order_relaxed);
+}
+
+void setTraceThreadName(const std::string &name) {
+	threadName = name;
+}
+
+/*
+ * The calling thread's buffer, made and added to the list the first time.
+ */
+static ThreadTrace* threadTrace() {
+	if (myTrace == 0) {
+		myTrace = new ThreadTrace();
+		myTrace->tid = syscall(SYS_gettid);
+		myTrace->name = (threadName != "") ? threadName : "thread " + to_string(myTrace->tid);
+		myTrace->first = myTrace->last = new TraceBlock();
+		myTrace->spans = 0;
+		myTrace->dropped = 0;
+		ThreadTrace *head = traces.load();
+		do {
+			myTrace->next = head;
+		} while (!traces.compare_exchange_weak(head, myTrace));
+	}
+	return myTrace;
+}
+
+void recordSpan(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, long arg) {
+
+	ThreadTrace *t = threadTrace();
+	if (t->spans >= TRACE_MAX_SPANS) {
+		t->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+	TraceBlock *b = t->last;
+	int used = b->used.load(memory_order_relaxed);
+	if (used == TRACE_BLOCK) {
+		TraceBlock *fresh = new TraceBlock();
+		b->next.store(fresh, memory_order_release);
+		t->last = b = fresh;
+		used = 0;
+	}
+	TraceEvent &e = b->events[used];
+	e.name = name;
+	e.start = chrono::duration_cast<chrono::nanoseconds>(start - epoch).count();
+	e.duration = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+	e.arg = arg;
+	b->used.store(used + 1, memory_order_release);
+	t->spans++;
+}
+
+void writeTrace() {
+
+	if (!on || written.exchange(true)) {
+		return;
+	}
+	FILE *out = fopen(traceFile.c_str(), "w");
+	if (out == 0) {
+		cerr << "Could not write trace " << traceFile << endl;
+		return;
+	}
+
+	long pid = getpid();
+	long dropped = 0;
+	fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %ld, \"tid\": 0, \"args\": {\"name\": \"gpsr\"}}", pid);
+	for (ThreadTrace *t = traces.load(memory_order_acquire); t != 0; t = t->next) {
+		fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %ld, \"tid\": %ld, \"args\": {\"name\": \"%s\"}}",
+			pid, t->tid, t->name.c_str());
+		for (TraceBlock *b = t->first; b != 0; b = b->next.load(memory_order_acquire)) {
+			int used = b->used.load(memory_order_acquire);
+			for (int i = 0; i < used; i++) {
+				const TraceEvent &e = b->events[i];
+				fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %ld, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f",
+					e.name, pid, t->tid, e.start / 1000.0, e.duration / 1000.0);
+				if (e.arg >= 0) {
+					fprintf(out, ", \"args\": {\"n\": %ld}", e.arg);
+				}
+				fprintf(out, "}");
+			}
+		}
+		dropped += t->dropped.load(memory_order_relaxed);
+	}
+	fprintf(out, "\n]}\n");
+	if (fclose(out) != 0) {
+		cerr << "Could not write trace " << traceFile << endl;
+	}
+	if (dropped > 0) {
+		cerr << "The trace is missing " << dropped << " spans (more than " << TRACE_MAX_SPANS << " on a thread)" << endl;
+	}
+}
+
+//
+// TraceSpan
+//
+
+TraceSpan::TraceSpan(const char *name, long arg) {
+	this->name = name;
+	this->arg = arg;
+	active = tracing();
+	if (active) {
+		start = Clock::now();
+	}
+}
+
+TraceSpan::~TraceSpan() {
+	if (active) {
+		recordSpan(name, start, Clock::now(), arg);
+	}
+}
@@ -0,0 +1,83 @@
+/** \file trace.h
+ * Tracing what each thread does over time (--trace), for viewing in
+ * Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Spans (a name, a start and a duration on one thread) are recorded by
+ * scoped TraceSpan objects around the phases of each generation (the timed
+ * phases of timing.h, which trace themselves), the evaluation of each
+ * individual or chunk of fitness cases, checkpoint writes and migrations.
+ * Each thread records into a buffer of its own, a list of fixed-size
+ * blocks that only it appends to, publishing each span with an atomic
+ * store, so recording takes no locks and the trace can be written out while
+ * the threads carry on. The buffers are written as Chrome trace-event JSON
+ * when gpsr exits (a run stopped by SIGINT or SIGTERM exits too).
+ *
+ * When tracing is off a span costs a test of a flag; with -DGPSR_NO_TIMING
+ * (see timing.h) TRACE_SPAN compiles to nothing and --trace is refused.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <chrono>
+
+/* the most spans kept per thread (later ones are counted and dropped) */
+#define TRACE_MAX_SPANS (1 << 20)
+
+/**
+ * Start tracing, to be written to a file at exit.
+ * @param filename the trace file
+ */
+void startTracing(const std::string &filename);
+
+/**
+ * Gets whether spans are being recorded.
+ */
+bool tracing();
+
+/**
+ * Name the calling thread in the trace (before it records anything).
+ */
+void setTraceThreadName(const std::string &name);
+
+/**
+ * Record a span on the calling thread.
+ * @param name what it was (a string that lives as long as the program)
+ * @param start when it started
+ * @param end when it ended
+ * @param arg a number to go with it (e.g. the individual), or -1
+ */
+void recordSpan(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, long arg);
+
+/**
+ * Write out the trace as it is so far (startTracing() arranges for this
+ * to happen at exit).
+ */
+void writeTrace();
+
+/**
+ * Records the scope it lives in as a span (if tracing).
+ */
+class TraceSpan {
+
+	public:
+
+		TraceSpan(const char *name, long arg = -1);
+		~TraceSpan();
+
+	private:
+
+		const char *name;
+		long arg;
+		bool active;
+		std::chrono::steady_clock::time_point start;
+};
+
+#ifndef GPSR_NO_TIMING
+#define TRACE_SPAN(...) TraceSpan traceSpan(__VA_ARGS__)
+#else
+#define TRACE_SPAN(...)
+#endif
+
+#endif
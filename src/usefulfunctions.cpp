@@ -3,10 +3,16 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <csignal>
+#include <cstring>
 #include <getopt.h>
 #include "global.h"
 #include "usefulfunctions.h"
 #include "rng.h"
+#include "threadpool.h"
+#include "dataio.h"
+#include "streaming.h"
+#include "shareddata.h"
 
 using namespace std;
 
@@ -33,7 +39,7 @@ ResultType protectedDivision(const ResultType &a, const ResultType &b) {
 	return ret;
 }
 
-int countHits(const ResultType &targets, const ResultType &guesses, double criterion) {
+int countHits(const DataColumn &targets, const ResultType &guesses, double criterion) {
 	int ret=0;
 
 	double err = 0.0;
@@ -72,6 +78,9 @@ ResultType protectedLog(const ResultType &a) {
 }
 
 int intRandom(const int &low, const int &high) {
+	if (rng.getEngine() == RNG::XOSHIRO) {
+		return rng.intRandom(low, high);
+	}
 	int nb = high - low + 1;
 	return (int)(rng.uniform()*nb + low);
 }
@@ -81,6 +90,20 @@ double dblRandom(const double &low, const double &high) {
 	return (rng.uniform()*nb + low);
 }
 
+bool potencyFlip() {
+
+	// Apply LS at smaller amounts at the start of the run and 
+	// increase as the run progresses
+	double run_progress = ( ((double) currentgen) / ((double) config->numgens) );
+
+	// or, apply more LS at the start and less at the end
+	if (!config->potency_increasing) {
+			run_progress = 1.0 - run_progress;
+	}
+
+	return rng.flip(run_progress);
+}
+
 double jitter(const double &val, const double &factor) {
 	return dblRandom(val - (val * factor), val + (val * factor));
 }
@@ -95,8 +118,8 @@ void applyJitter() {
 		int newSize = variables.size() * jitterAmount;
 
 		// create copies of the variables and targets and resize accordingly
-		std::vector<ResultType> tmpVar = variables;
-		ResultType tmpTrg = targets;
+		std::vector<DataColumn> tmpVar = variables;
+		DataColumn tmpTrg = targets;
 		tmpVar.resize(newSize);
 		tmpTrg.resize(newSize);
 
@@ -177,85 +200,51 @@ void loadFiles(const std::string &training_file, const std::string& testing_file
 	else
 	{ 	
 		// load data
-
-		ifstream data(training_file.c_str());
-		if (!data) {
+		bool hasHeader;
+		int bad;
+		if (streamChunk > 0) {
+			bad = openTrainingStream(training_file, streamChunk, hasHeader);
+		}
+		else if (shared_data && !train_with_noise) {
+			// (jitter changes the training data, so it is kept private then)
+			bad = readSharedDataset(training_file, variables, targets, hasHeader);
+		}
+		else {
+			bad = readDataset(training_file, variables, targets, hasHeader);
+		}
+		if (bad < 0) {
 			cerr << "Could not open training datafile " << training_file << endl;
 			exit(1);
 		}
-		string line;
-		getline(data, line); // read first (header) line
-
-		if (line[0] != '#') { 
+		if (!hasHeader) { 
 			cerr << "Training datafile needs a header line" << endl;
 		}
-		istringstream is(line);
-		is.get(); // skip #
-		int ncases;
-		int nvars;
-		is >> ncases;
-		is >> nvars;
-		--nvars; // last one is target
-		
-		// reset global numVariables
-		numVariables = nvars;
-
-		//cout << "Loading training data, ncases = " << ncases << ", nvars = " << nvars << endl;
-
-		variables.resize(nvars);
-		targets.resize(ncases);
-		for (int i = 0; i < nvars; ++i) {
-			variables[i].resize(ncases);
+		if (bad > 0) {
+			cerr << "Something went wrong reading in the training data" << endl;
+			cerr << "at line " << bad << endl;
+			exit(1);
 		}
 
-		for (int i = 0; i < ncases; ++i) {
-			for (int j = 0; j < nvars; ++j) {
-				data >> variables[j][i];
-			}
-
-			data >> targets[i];
+		// reset global numVariables
+		numVariables = (streamChunk > 0) ? trainingStream()->getNumVariables() : variables.size();
 
-			if (!data) {
-				cerr << "Something went wrong reading in the training data" << endl;
-				cerr << "at line " << i+1 << endl;
-				exit(1);
-			}
+		if (shared_data) {
+			bad = readSharedDataset(testing_file, test_variables, test_targets, hasHeader);
 		}
-
-		ifstream test_data(testing_file.c_str());
-		if (!test_data) {
+		else {
+			bad = readDataset(testing_file, test_variables, test_targets, hasHeader);
+		}
+		if (bad < 0) {
 			cerr << "Could not open testing datafile " << testing_file << endl;
 			exit(1);
 		}
-		getline(test_data, line); //nb: reuse of line
-		if (line[0] != '#') { 
+		if (!hasHeader) { 
 			cerr << "Testing datafile needs a header line" << endl;
 		}
-		istringstream is2(line);
-		is2.get(); // reuse of is again (might need a new one)
-		is2 >> ncases;
-		is2 >> nvars;
-		--nvars;
-
-		//cout << "Loading testing data, ncases = " << ncases << ", nvars = " << nvars << endl;
-		test_variables.resize(nvars);
-		test_targets.resize(ncases);
-		for (int i = 0; i < nvars; ++i) {
-			test_variables[i].resize(ncases);
+		if (bad > 0) {
+			cerr << "Something went wrong reading in the testing data" << endl;
+			cerr << "at line " << bad << endl;
 		}
-		for (int i=0; i<ncases; i++) {
-			for (int j=0; j<nvars; j++) {
-				test_data >> test_variables[j][i];
-			}
-			test_data >> test_targets[i];
-
-			if (!test_data) {
-				cerr << "Something went wrong reading in the testing data" << endl;
-				cerr << "at line " << i+1 << endl;
-			}
-		}
-		data.close();
-		test_data.close();
 	}
 
 	// if training with noise is specified, apply jitter to inputs
@@ -330,11 +319,126 @@ void printHelp(char* arg)
     cout << "-F num   \t jitter factor (default: 2)\n";
     cout << "-A num   \t jitter amount (default: 0.01)\n";
     cout << "-c num   \t hits criterion (default: 0.01)\n";
+    cout << "-T num   \t number of threads used for fitness evaluation (default: 1)\n";
+    cout << "-U file  \t per-generation thread utilisation log (default: none)\n";
+    cout << "-S num   \t data-parallel evaluation on shards of num fitness cases (default: 0 = off)\n";
+    cout << "-B       \t breed in parallel, with a random stream per offspring (off by default)\n";
+    cout << "-E name  \t random number generator: xoshiro or mwc (the original, default: xoshiro)\n";
+    cout << endl;
+    cout << "-I num   \t number of islands, each evolving popsize/num individuals on its own thread (default: 1)\n";
+    cout << "--migration-interval num\t generations between migrations (default: 10)\n";
+    cout << "--migration-rate num    \t number of individuals each island sends per migration (default: 2)\n";
+    cout << "--topology ring|random  \t where migrants go (default: ring)\n";
+    cout << "--listen addr           \t receive migrants from other gpsr processes on addr (unix:/path or host:port)\n";
+    cout << "--send-to addr[,addr..] \t send migrants to other gpsr processes (in turn)\n";
+    cout << "--runs num              \t num independent runs (seeds seed..seed+num-1) sharing the data, on -T threads;\n";
+    cout << "                        \t run r is logged to <results file>.r, its best saved to <best file>.r\n";
+    cout << "--sweep spec            \t run every combination of settings in spec, e.g. \"x=0.5,0.9 t=3,7 l=0,1 P=off,1\"\n";
+    cout << "                        \t (with --runs seeds each), results in <results file>.sweep\n";
+    cout << "--sweep-file file       \t as --sweep, with one spec per line of file\n";
+    cout << "--steady-state          \t asynchronous steady-state evolution on -T threads, for popsize x generations evaluations\n";
+    cout << "--log-every num         \t with --steady-state, log every num evaluations (default: popsize)\n";
+    cout << "--workers addr[,addr..] \t evaluate fitness on gpsr-worker processes listening on addr\n";
+    cout << "--local-workers num     \t start num gpsr-worker processes on this machine to evaluate fitness\n";
+    cout << "--stream num            \t read the training data num fitness cases at a time instead of loading it\n";
+    cout << "--shared-data           \t share the data (read-only) with other gpsr processes on this host that load the same files\n";
+    cout << "--log-format text|binary\t results file format (default: text; '" << arg << " printlog file' prints a binary one)\n";
+    cout << "--checkpoint file       \t save the state of the run to file every --checkpoint-every generations\n";
+    cout << "--checkpoint-every num  \t generations between checkpoints (default: 10)\n";
+    cout << "--resume file           \t carry on the run checkpointed in file (with the same data and settings)\n";
+    cout << "--seed-population file[,file..]\t start populations with the models in the files (as saved in <best file>.model)\n";
+    cout << "--timing-log file       \t per-generation time spent in each phase, and fitness cases and nodes evaluated\n";
+    cout << "--perf-log file         \t per-generation hardware counters (cycles, instructions, cache and branch misses)\n";
+    cout << "                        \t of the operators and the fitness evaluation, summed up at the end (Linux only)\n";
+    cout << "--trace file            \t write what each thread does over time to file, as Chrome trace JSON (for Perfetto)\n";
     cout << endl;
+    cout << "Data files are text, or binary as written by: " << arg << " convert datafile binaryfile\n";
+    cout << endl;
+}
+
+// long options without a short equivalent
+enum {
+	OPT_MIGRATION_INTERVAL = 256,
+	OPT_MIGRATION_RATE,
+	OPT_TOPOLOGY,
+	OPT_LISTEN,
+	OPT_SEND_TO,
+	OPT_WORKERS,
+	OPT_LOCAL_WORKERS,
+	OPT_STEADY_STATE,
+	OPT_LOG_EVERY,
+	OPT_RUNS,
+	OPT_SWEEP,
+	OPT_SWEEP_FILE,
+	OPT_STREAM,
+	OPT_SHARED_DATA,
+	OPT_LOG_FORMAT,
+	OPT_CHECKPOINT,
+	OPT_CHECKPOINT_EVERY,
+	OPT_RESUME,
+	OPT_SEED_POPULATION,
+	OPT_TIMING_LOG,
+	OPT_PERF_LOG,
+	OPT_TRACE
+};
+
+static struct option longOptions[] = {
+	{ "islands",            required_argument, 0, 'I' },
+	{ "migration-interval", required_argument, 0, OPT_MIGRATION_INTERVAL },
+	{ "migration-rate",     required_argument, 0, OPT_MIGRATION_RATE },
+	{ "topology",           required_argument, 0, OPT_TOPOLOGY },
+	{ "listen",             required_argument, 0, OPT_LISTEN },
+	{ "send-to",            required_argument, 0, OPT_SEND_TO },
+	{ "workers",            required_argument, 0, OPT_WORKERS },
+	{ "local-workers",      required_argument, 0, OPT_LOCAL_WORKERS },
+	{ "steady-state",       no_argument,       0, OPT_STEADY_STATE },
+	{ "log-every",          required_argument, 0, OPT_LOG_EVERY },
+	{ "runs",               required_argument, 0, OPT_RUNS },
+	{ "sweep",              required_argument, 0, OPT_SWEEP },
+	{ "sweep-file",         required_argument, 0, OPT_SWEEP_FILE },
+	{ "stream",             required_argument, 0, OPT_STREAM },
+	{ "shared-data",        no_argument,       0, OPT_SHARED_DATA },
+	{ "log-format",         required_argument, 0, OPT_LOG_FORMAT },
+	{ "checkpoint",         required_argument, 0, OPT_CHECKPOINT },
+	{ "checkpoint-every",   required_argument, 0, OPT_CHECKPOINT_EVERY },
+	{ "resume",             required_argument, 0, OPT_RESUME },
+	{ "seed-population",    required_argument, 0, OPT_SEED_POPULATION },
+	{ "timing-log",         required_argument, 0, OPT_TIMING_LOG },
+	{ "perf-log",           required_argument, 0, OPT_PERF_LOG },
+	{ "trace",              required_argument, 0, OPT_TRACE },
+	{ 0, 0, 0, 0 }
+};
+
+bool setConfigOption(RunConfig &cfg, char option, const char *value) {
+
+	// flags are switched on by their option alone, or set with 1/0
+	bool on = (value == 0 || string(value) != "0");
+	if (value == 0 && option != 'n' && option != 'l') {
+		return false;
+	}
+
+	switch (option) {
+		case 'g': cfg.numgens = atoi(value); break;
+		case 'p': cfg.popsize = atoi(value); break;
+		case 'x': cfg.crossover_prob = (double) atof(value); break;
+		case 'm': cfg.mutation_prob = (double) atof(value); break;
+		case 't': cfg.tournamentSize = atoi(value); break;
+		case 'n': cfg.no_same_mates = on; break;
+		case 'l': cfg.linear_scaling = on; break;
+		case 's': cfg.genomeSize = atoi(value); break;
+		case 'P':
+			// P=off switches potency off again (for sweeps)
+			cfg.use_potency = (string(value) != "off");
+			cfg.potency_increasing = (atoi(value) == 1);
+			break;
+		case 'c': cfg.hitsCriterion = (double) atof(value); break;
+		default: return false;
+	}
+	return true;
 }
 
 void setupGlobals(int argc, char* argv[]) {
-    string optionstring = "g:p:x:m:t:hu:nlD:o:d:f:s:r:j:LP:O:JA:F:c:";
+    string optionstring = "g:p:x:m:t:hu:nlD:o:d:f:s:r:j:LP:O:JA:F:c:T:U:S:BE:I:";
     
     if (argc == 1) {
 	    printHelp(argv[0]);
@@ -343,41 +447,125 @@ void setupGlobals(int argc, char* argv[]) {
     
     while(1)
     {
-			int c = getopt(argc,argv,optionstring.c_str());
+			int c = getopt_long(argc,argv,optionstring.c_str(),longOptions,0);
 
 			if (c == -1)
 				break;
 
-			switch(char(c))
+			switch(c)
 			{
-				case 'g': numgens = atoi(optarg); break;
-				case 'p': popsize = atoi(optarg);break;
-				case 'x': crossover_prob = (double) atof(optarg);break;
-				case 'm': mutation_prob = (double) atof(optarg);break;
-				case 't': tournamentSize = atoi(optarg); break;
+				case 'g':
+				case 'p':
+				case 'x':
+				case 'm':
+				case 't':
+				case 'n':
+				case 'l':
+				case 's':
+				case 'P':
+				case 'c':
+					setConfigOption(baseConfig, c, optarg);
+					break;
 				case 'u': unaries = optarg; break;
 				case 'D': seed = atoi(optarg); seed_specified = true; break;
-				case 'n': no_same_mates = true; break;
-				case 'l': linear_scaling = true; break;
 				case 'o': best_file = optarg; break;
 				case 'd': training_file = optarg; break;
 				case 'f': testing_file = optarg; break;
-				case 's': genomeSize = atoi(optarg); break;
 				case 'r': constRange = atof(optarg); break;
 				case 'j': numConstants = atoi(optarg); break;
 				case 'L': loose_metric = true; break;
-				case 'P': use_potency = true; potency_increasing = ( (atoi(optarg) == 1) ? true : false );  break;
 				case 'O': logfile = optarg; break;
 				case 'J': train_with_noise=true; break;
 				case 'F': jitterFactor = (double) atof(optarg); break;
 				case 'A': jitterAmount = atoi(optarg); break;
-				case 'c': hitsCriterion = (double) atof(optarg); break;
+				case 'T': numThreads = atoi(optarg); break;
+				case 'U': utilisation_file = optarg; break;
+				case 'S': shardSize = atoi(optarg); break;
+				case 'B': parallel_breeding = true; break;
+				case 'E':
+					if (string(optarg) == "mwc") {
+						RNG::setDefaultEngine(RNG::MWC);
+					}
+					else if (string(optarg) == "xoshiro") {
+						RNG::setDefaultEngine(RNG::XOSHIRO);
+					}
+					else {
+						printHelp(argv[0]);
+						exit(1);
+					}
+					break;
+				case 'I': numIslands = atoi(optarg); break;
+				case OPT_MIGRATION_INTERVAL: migrationInterval = atoi(optarg); break;
+				case OPT_MIGRATION_RATE: migrationRate = atoi(optarg); break;
+				case OPT_TOPOLOGY:
+					migration_topology = optarg;
+					if (migration_topology != "ring" && migration_topology != "random") {
+						printHelp(argv[0]);
+						exit(1);
+					}
+					break;
+				case OPT_LISTEN: migration_listen = optarg; break;
+				case OPT_SEND_TO: {
+					stringstream list(optarg);
+					string address;
+					while (getline(list, address, ',')) {
+						if (address != "") {
+							migration_destinations.push_back(address);
+						}
+					}
+					break;
+				}
+				case OPT_WORKERS: {
+					stringstream list(optarg);
+					string address;
+					while (getline(list, address, ',')) {
+						if (address != "") {
+							farm_workers.push_back(address);
+						}
+					}
+					break;
+				}
+				case OPT_LOCAL_WORKERS: localWorkers = atoi(optarg); break;
+				case OPT_STEADY_STATE: steady_state = true; break;
+				case OPT_LOG_EVERY: logInterval = atol(optarg); break;
+				case OPT_RUNS: numRuns = atoi(optarg); break;
+				case OPT_SWEEP: sweep_spec = optarg; break;
+				case OPT_SWEEP_FILE: sweep_file = optarg; break;
+				case OPT_STREAM: streamChunk = atol(optarg); break;
+				case OPT_SHARED_DATA: shared_data = true; break;
+				case OPT_LOG_FORMAT:
+					if (string(optarg) != "text" && string(optarg) != "binary") {
+						printHelp(argv[0]);
+						exit(1);
+					}
+					binary_log = (string(optarg) == "binary");
+					break;
+				case OPT_CHECKPOINT: checkpoint_file = optarg; break;
+				case OPT_CHECKPOINT_EVERY: checkpointInterval = atoi(optarg); break;
+				case OPT_RESUME: resume_file = optarg; break;
+				case OPT_SEED_POPULATION: {
+					stringstream list(optarg);
+					string file;
+					while (getline(list, file, ',')) {
+						if (file != "") {
+							seed_files.push_back(file);
+						}
+					}
+					break;
+				}
+				case OPT_TIMING_LOG: timing_file = optarg; break;
+				case OPT_PERF_LOG: perf_file = optarg; break;
+				case OPT_TRACE: trace_file = optarg; break;
 				case 'h': printHelp(argv[0]); exit(1);
 				default:
 				printHelp(argv[0]);
 				exit(1);
 			}
     }
+
+    // the generator may have changed, so restart the stream that the
+    // constants (and jitter) are drawn from, as at startup
+    rng.reseed(1);
 }
 
 void setupConstants() {
@@ -444,6 +632,28 @@ void cleanup() {
 	t_constants.clear();
 }
 
+static void onStopSignal(int sig) {
+	stopSignal = sig;
+}
+
+void catchStopSignals() {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onStopSignal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART | SA_RESETHAND;
+	sigaction(SIGINT, &sa, 0);
+	sigaction(SIGTERM, &sa, 0);
+}
+
+int exitStatus() {
+	if (stopSignal != 0) {
+		cerr << "Stopped early by signal " << stopSignal << endl;
+		return 128 + stopSignal;
+	}
+	return EXIT_SUCCESS;
+}
+
 string printArray(std::vector<int> data) 
 {
 	string ret;
@@ -458,26 +668,129 @@ string printArray(std::vector<int> data)
 	return ret;
 }
 
+void logUtilisation(std::ostream &os, int generation) {
+	ThreadPool &pool = workerPool();
+	std::vector<ThreadPool::WorkerStats> stats = pool.getStats();
+	double elapsed = pool.getElapsedSeconds();
+
+	os << generation;
+	for (unsigned i = 0; i < stats.size(); i++) {
+		os << "\t" << ( (elapsed > 0.0) ? stats[i].busySeconds / elapsed : 0.0 );
+	}
+	for (unsigned i = 0; i < stats.size(); i++) {
+		os << "\t" << stats[i].steals;
+	}
+	os << "\n";
+	pool.resetStats();
+}
+
+std::vector<std::string> reopenLog(std::ofstream &os, const std::string &filename, int generation) {
+
+	vector<string> kept;
+	string contents;
+	{
+		ifstream in(filename.c_str());
+		string line;
+		while (getline(in, line)) {
+			if (line.size() > 0 && line[0] == '#') {
+				contents += line + "\n";
+			}
+			else if (line.size() > 0 && atol(line.c_str()) <= generation) {
+				kept.push_back(line);
+				contents += line + "\n";
+			}
+		}
+	}
+	os.open(filename.c_str(), ios::trunc);
+	os << contents;
+	return kept;
+}
+
 void printSettings() {
 	cout << "Run settings:\n";
 	cout << "------------------------------------------" << endl;
-	cout << "population size:       " << popsize << endl;
-	cout << "genome size:           " << genomeSize << endl;
-	cout << "number of generations: " << numgens << endl;
-	cout << "crossover rate:        " << crossover_prob << endl;
-	cout << "mutation rate:         " << mutation_prob << endl;
-	cout << "tournament size:       " << tournamentSize << endl;
+	cout << "population size:       " << config->popsize << endl;
+	cout << "genome size:           " << config->genomeSize << endl;
+	cout << "number of generations: " << config->numgens << endl;
+	cout << "crossover rate:        " << config->crossover_prob << endl;
+	cout << "mutation rate:         " << config->mutation_prob << endl;
+	cout << "tournament size:       " << config->tournamentSize << endl;
 	cout << "number of constants:   " << numConstants << endl;
 	cout << "number of variables:   " << numVariables << endl;
 	cout << "constant range:        " << constRange << endl;
 	cout << "random seed:           " << seed << endl;
-	cout << "hits criterion:        " << hitsCriterion << endl;
-	cout << "linear scaling:        " << (linear_scaling ? "on" : "off") << endl;
+	cout << "random generator:      " << (rng.getEngine() == RNG::MWC ? "mwc" : "xoshiro") << endl;
+	cout << "hits criterion:        " << config->hitsCriterion << endl;
+	cout << "threads:               " << numThreads << endl;
+	cout << "parallel breeding:     " << (parallel_breeding ? "on" : "off") << endl;
+	if (numIslands > 1) {
+		cout << "islands:               " << numIslands << endl;
+		cout << "migration interval:    " << migrationInterval << endl;
+		cout << "migration rate:        " << migrationRate << endl;
+		cout << "migration topology:    " << migration_topology << endl;
+	}
+	if (sweep_spec != "") {
+		cout << "sweep:                 " << sweep_spec << endl;
+	}
+	if (sweep_file != "") {
+		cout << "sweep file:            " << sweep_file << endl;
+	}
+	if (numRuns > 1) {
+		cout << "runs:                  " << numRuns << " (seeds " << seed << ".." << seed + numRuns - 1 << ")" << endl;
+	}
+	if (steady_state) {
+		cout << "steady state:          on, logging every " << (logInterval > 0 ? logInterval : config->popsize) << " evaluations" << endl;
+	}
+	if (localWorkers > 0) {
+		cout << "local workers:         " << localWorkers << endl;
+	}
+	for (unsigned i = 0; i < farm_workers.size(); i++) {
+		cout << "evaluation worker:     " << farm_workers[i] << endl;
+	}
+	if (migration_listen != "" || !migration_destinations.empty()) {
+		cout << "migration interval:    " << migrationInterval << endl;
+		cout << "migration rate:        " << migrationRate << endl;
+		cout << "receiving migrants on: " << (migration_listen != "" ? migration_listen : "-") << endl;
+		for (unsigned i = 0; i < migration_destinations.size(); i++) {
+			cout << "sending migrants to:   " << migration_destinations[i] << endl;
+		}
+	}
+	if (shardSize > 0) {
+		cout << "shard size:            " << shardSize << endl;
+	}
+	if (shared_data) {
+		cout << "shared data:           on" << endl;
+	}
+	if (binary_log) {
+		cout << "results file format:   binary" << endl;
+	}
+	if (checkpoint_file != "") {
+		cout << "checkpoint:            " << checkpoint_file << ", every " << checkpointInterval << " generations" << endl;
+	}
+	if (timing_file != "") {
+		cout << "timing log:            " << timing_file << endl;
+	}
+	if (perf_file != "") {
+		cout << "counter log:           " << perf_file << endl;
+	}
+	if (trace_file != "") {
+		cout << "trace:                 " << trace_file << endl;
+	}
+	for (unsigned i = 0; i < seed_files.size(); i++) {
+		cout << "seed models:           " << seed_files[i] << endl;
+	}
+	if (resume_file != "") {
+		cout << "resumed from:          " << resume_file << endl;
+	}
+	if (streamChunk > 0) {
+		cout << "streaming:             " << numTrainingCases() << " cases, " << streamChunk << " at a time" << endl;
+	}
+	cout << "linear scaling:        " << (config->linear_scaling ? "on" : "off") << endl;
 	
-	if (linear_scaling) {
-		cout << "LS potency:            " << (use_potency ? "on" : "off") << endl;
-		if (use_potency) {
-			cout << "potency operation:     " << (potency_increasing ? " (increasing)" : " (decreasing)") << endl;
+	if (config->linear_scaling) {
+		cout << "LS potency:            " << (config->use_potency ? "on" : "off") << endl;
+		if (config->use_potency) {
+			cout << "potency operation:     " << (config->potency_increasing ? " (increasing)" : " (decreasing)") << endl;
 		}
 	}
 	// print info about jitter, if it is enabled
@@ -5,6 +5,12 @@
 #ifndef USEFULFUNCTIONS_H
 #define USEFULFUNCTIONS_H
 
+#include <string>
+#include <vector>
+#include <fstream>
+
+struct RunConfig;
+
 //
 // ~~~~~~~~ GP-specific functions ~~~~~~~~~~
 // 
@@ -57,6 +63,14 @@ ResultType protectedDivision(const ResultType &a, const ResultType &b);
  */
 double protectedLog(const double &a);
 
+/**
+ * Potency coin flip. Decides whether linear scaling is applied to an 
+ * individual this generation: LS is applied at smaller amounts at the start 
+ * of the run and more towards the end (or the reverse, if potency is decreasing).
+ * @return true if the LS coefficients should be recalculated
+ */
+bool potencyFlip();
+
 /**
  * Apply random noise to the input set.
  */
@@ -81,7 +95,7 @@ ResultType protectedLog(const ResultType &a);
  * @param criterion the distance criterion
  * @return the number of times the guesses come within the range of the targets.
  */
-int countHits(const ResultType &targets, const ResultType &guesses, double criterion);
+int countHits(const DataColumn &targets, const ResultType &guesses, double criterion);
 
 /**
  * Get a random variable.
@@ -154,6 +168,16 @@ void clearStack();
  */
 void createResultType(double value, ResultType & res);
 
+/**
+ * Set one of the run settings, as its command line option would.
+ * @param cfg the settings
+ * @param option the option letter (g, p, x, m, t, n, l, s, P or c)
+ * @param value its value (1/0 for the n and l flags, which may also be
+ * given no value; off for P switches potency off)
+ * @return false if there is no such option (or the value is missing)
+ */
+bool setConfigOption(RunConfig &cfg, char option, const char *value);
+
 /**
  * Set up the global variables from the arguments.
  * @param argc the number of arguments
@@ -201,5 +225,40 @@ void printSettings();
  */
 void cleanup();
 
+/**
+ * Have SIGINT and SIGTERM stop the run in an orderly way: they set
+ * stopSignal, and the run stops at the end of the generation and saves its
+ * best, logs and checkpoint as if it had finished. A second signal stops
+ * gpsr there and then.
+ */
+void catchStopSignals();
+
+/**
+ * The exit status of gpsr after its run: EXIT_SUCCESS, or if it was stopped
+ * by a signal, 128 + the signal (as if the signal had ended it).
+ */
+int exitStatus();
+
 std::string printArray(std::vector<int> data) ;
+
+/**
+ * Writes one line of worker pool statistics: the generation, the utilisation
+ * (busy time / time spent in parallel jobs) of each thread and the number of
+ * tasks each thread stole. The pool counters are reset afterwards.
+ * @param os the stream to write to
+ * @param generation the current generation
+ */
+void logUtilisation(std::ostream &os, int generation);
+
+/**
+ * Opens a per-generation log (one tab-separated line per generation, the
+ * generation first, and # comment lines) to carry on with a resumed run:
+ * the lines of generations after the checkpoint are cut off, so they aren't
+ * logged twice.
+ * @param os the stream to open, for appending
+ * @param filename the log
+ * @param generation the generation of the checkpoint
+ * @return the lines kept, but for the comments
+ */
+std::vector<std::string> reopenLog(std::ofstream &os, const std::string &filename, int generation);
 #endif
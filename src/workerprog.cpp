@@ -0,0 +1,37 @@
+#include <iostream>
+#include <string>
+
+#include "global.h"
+#include "evalfarm.h"
+#include "usefulfunctions.h"
+
+using namespace std;
+
+/*
+ * gpsr-worker: serves fitness evaluations to a gpsr master (see evalfarm.h).
+ *
+ * usage: gpsr-worker address [gpsr options]
+ *
+ * The options must give the same data and settings as the master's.
+ */
+int main( int argc, char* argv[] ) {
+
+	if (argc < 2 || argv[1][0] == '-') {
+		cerr << "usage: " << argv[0] << " address [gpsr options]" << endl;
+		cerr << "  address: unix:/path or host:port to serve evaluations on" << endl;
+		cerr << "  options: the master's data and settings (-d, -f, -l, -j, -r, ...)" << endl;
+		return EXIT_FAILURE;
+	}
+	string address = argv[1];
+
+	// the rest is parsed as gpsr's own command line
+	argv[1] = argv[0];
+	setupGlobals(argc - 1, argv + 1);
+	loadFiles(training_file, testing_file);
+	setupNodeLists();
+
+	serveEvaluations(address);
+
+	cleanup();
+	return EXIT_FAILURE;
+}